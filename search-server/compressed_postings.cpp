@@ -0,0 +1,107 @@
+#include "compressed_postings.h"
+
+namespace {
+
+void WriteVarint(std::vector<uint8_t>& out, uint32_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t ReadVarint(const uint8_t*& in)
+{
+    uint32_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        const uint8_t byte = *in++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return value;
+    }
+}
+
+} // namespace
+
+void CompressedPostings::Assign(const std::vector<int>& document_ids,
+                                const std::vector<double>& term_freqs)
+{
+    blocks_.clear();
+    deltas_.clear();
+    term_freqs_.clear();
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        Append(document_ids[i], term_freqs[i]);
+    }
+    blocks_.shrink_to_fit();
+    deltas_.shrink_to_fit();
+    term_freqs_.shrink_to_fit();
+}
+
+void CompressedPostings::Append(int document_id, double term_freq)
+{
+    if (term_freqs_.size() % BLOCK_SIZE == 0) {
+        blocks_.push_back({document_id, document_id, static_cast<uint32_t>(deltas_.size())});
+    } else {
+        Block& block = blocks_.back();
+        WriteVarint(deltas_, static_cast<uint32_t>(document_id - block.last_document_id));
+        block.last_document_id = document_id;
+    }
+    term_freqs_.push_back(static_cast<float>(term_freq));
+}
+
+void CompressedPostings::Decode(std::vector<int>& document_ids,
+                                std::vector<double>& term_freqs) const
+{
+    document_ids.resize(size());
+    for (size_t block = 0; block < blocks_.size(); ++block) {
+        DecodeBlock(block, document_ids.data() + block * BLOCK_SIZE);
+    }
+    term_freqs.assign(term_freqs_.begin(), term_freqs_.end());
+}
+
+size_t CompressedPostings::size() const
+{
+    return term_freqs_.size();
+}
+
+bool CompressedPostings::empty() const
+{
+    return term_freqs_.empty();
+}
+
+size_t CompressedPostings::GetBlockCount() const
+{
+    return blocks_.size();
+}
+
+int CompressedPostings::GetBlockLastDocumentId(size_t block) const
+{
+    return blocks_[block].last_document_id;
+}
+
+size_t CompressedPostings::DecodeBlock(size_t block, int* out) const
+{
+    const size_t count = block + 1 == blocks_.size()
+            ? size() - block * BLOCK_SIZE
+            : BLOCK_SIZE;
+    const uint8_t* in = deltas_.data() + blocks_[block].offset;
+    int document_id = blocks_[block].first_document_id;
+    out[0] = document_id;
+    for (size_t i = 1; i < count; ++i) {
+        document_id += static_cast<int>(ReadVarint(in));
+        out[i] = document_id;
+    }
+    return count;
+}
+
+double CompressedPostings::GetTermFreq(size_t position) const
+{
+    return term_freqs_[position];
+}
+
+size_t CompressedPostings::GetMemoryUsage() const
+{
+    return blocks_.capacity() * sizeof(Block)
+            + deltas_.capacity() * sizeof(uint8_t)
+            + term_freqs_.capacity() * sizeof(float);
+}
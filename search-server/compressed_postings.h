@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Сжатый список документов слова. id документов разбиты на блоки по BLOCK_SIZE,
+// внутри блока хранятся разности соседних id в кодировке varint. Для каждого
+// блока известны первый и последний id, поэтому ненужные блоки пропускаются
+// без распаковки. Частоты хранятся как float: погрешность много меньше EPSILON.
+class CompressedPostings {
+public:
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    void Assign(const std::vector<int>& document_ids, const std::vector<double>& term_freqs);
+    // id должен быть больше всех уже добавленных
+    void Append(int document_id, double term_freq);
+    void Decode(std::vector<int>& document_ids, std::vector<double>& term_freqs) const;
+
+    size_t size() const;
+    bool empty() const;
+
+    size_t GetBlockCount() const;
+    int GetBlockLastDocumentId(size_t block) const;
+    // Распаковывает id блока в out и возвращает их количество
+    size_t DecodeBlock(size_t block, int* out) const;
+    double GetTermFreq(size_t position) const;
+
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Block {
+        int first_document_id;
+        int last_document_id;
+        uint32_t offset;
+    };
+
+    std::vector<Block> blocks_{};
+    std::vector<uint8_t> deltas_{};
+    std::vector<float> term_freqs_{};
+};
@@ -0,0 +1,66 @@
+#include "concurrent_search_server.h"
+
+ConcurrentSearchServer::Snapshot ConcurrentSearchServer::GetSnapshot() const
+{
+    return std::atomic_load(&current_);
+}
+
+void ConcurrentSearchServer::Publish()
+{
+    // Удалитель не освобождает экземпляр, а сообщает, что последний
+    // запрос, получивший его через GetSnapshot, завершился
+    auto released = std::make_shared<std::promise<void>>();
+    published_released_ = released->get_future();
+    std::atomic_store(&current_, Snapshot{published_.get(), [released](const SearchServer*) {
+        released->set_value();
+    }});
+}
+
+void ConcurrentSearchServer::RebuildStandby()
+{
+    std::vector<RawDocument> documents;
+    for (const int document_id : *published_) {
+        const auto& document = published_->documents_.at(document_id);
+        documents.push_back({document_id, document.content, document.status, {document.rating}});
+    }
+    auto standby = std::make_unique<SearchServer>(stop_words_, posting_format_);
+    standby->AddDocuments(std::execution::par, documents);
+    standby_ = std::move(standby);
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id,
+                                         const std::string_view document,
+                                         DocumentStatus status,
+                                         const std::vector<int>& ratings)
+{
+    Modify([&](SearchServer& server) {
+        server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id)
+{
+    Modify([document_id](SearchServer& server) {
+        server.RemoveDocument(document_id);
+    });
+}
+
+std::vector<Document>
+ConcurrentSearchServer::FindTopDocuments(const std::string_view raw_query,
+                                         DocumentStatus status,
+                                         size_t result_count) const
+{
+    return GetSnapshot()->FindTopDocuments(raw_query, status, result_count);
+}
+
+ConcurrentSearchServer::MatchedDocument
+ConcurrentSearchServer::MatchDocument(const std::string_view raw_query, int document_id) const
+{
+    const auto [words, status] = GetSnapshot()->MatchDocument(raw_query, document_id);
+    return {std::vector<std::string>(words.begin(), words.end()), status};
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const
+{
+    return GetSnapshot()->GetDocumentCount();
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+
+#include <execution>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// SearchServer, в котором поиск не останавливается на время изменений.
+// Хранятся два экземпляра индекса: запросы читают опубликованный, а изменение
+// сначала применяется к запасному, затем экземпляры атомарно меняются местами,
+// и после того как старый экземпляр покинут все читавшие его запросы,
+// изменение повторяется и на нём. Запросы не ждут изменений и никогда не видят
+// частично добавленный документ; изменения выполняются по одному.
+// Плата за это - двойной объём памяти и двойная работа при изменении.
+class ConcurrentSearchServer {
+public:
+    using Snapshot = std::shared_ptr<const SearchServer>;
+
+    // Стоп-слова задаются так же, как для SearchServer
+    template <typename StopWordCollection>
+    explicit ConcurrentSearchServer(const StopWordCollection& stop_words,
+                                    PostingFormat posting_format = PostingFormat::PLAIN);
+
+    // Текущее состояние индекса для нескольких согласованных запросов.
+    // Пока снимок удерживается, изменения ждут его освобождения,
+    // поэтому хранить снимок долго нельзя; переживать сам
+    // ConcurrentSearchServer снимок тоже не должен.
+    Snapshot GetSnapshot() const;
+
+    void AddDocument(int document_id, const std::string_view document,
+                     DocumentStatus status, const std::vector<int>& ratings);
+
+    template <typename ExecutionPolicy, typename DocumentRange>
+    void AddDocuments(ExecutionPolicy&& policy, const DocumentRange& documents);
+
+    template <typename DocumentRange>
+    void AddDocuments(const DocumentRange& documents);
+
+    void RemoveDocument(int document_id);
+
+    template<typename Predicate, typename ExecutionPolicy>
+    std::vector<Document>
+    FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query,
+                     Predicate predicate,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template<typename Predicate>
+    std::vector<Document>
+    FindTopDocuments(const std::string_view raw_query, Predicate predicate,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template<typename ExecutionPolicy>
+    std::vector<Document>
+    FindTopDocuments(ExecutionPolicy&& policy,
+                     const std::string_view raw_query,
+                     DocumentStatus status = DocumentStatus::ACTUAL,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document>
+    FindTopDocuments(const std::string_view raw_query,
+                     DocumentStatus status = DocumentStatus::ACTUAL,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Слова возвращаются копиями: строки слов снимка переезжают,
+    // когда изменение повторяется на нём после публикации
+    using MatchedDocument = std::tuple<std::vector<std::string>, DocumentStatus>;
+    MatchedDocument MatchDocument(const std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+private:
+    std::vector<std::string> stop_words_{};
+    PostingFormat posting_format_;
+
+    std::unique_ptr<SearchServer> published_;
+    // Запасной экземпляр, доступен только под write_mutex_. Пуст, если
+    // повтор изменения на нём не удался; тогда он строится заново
+    std::unique_ptr<SearchServer> standby_;
+    std::mutex write_mutex_{};
+    // Сигнал о том, что опубликованный экземпляр больше никто не читает
+    std::future<void> published_released_{};
+    // Невладеющий указатель на published_, который получают запросы;
+    // читается и заменяется атомарно
+    Snapshot current_{};
+
+    void Publish();
+    // Строит запасной экземпляр по документам опубликованного
+    void RebuildStandby();
+
+    // Применяет mutation к обоим экземплярам. Если изменение отклонено
+    // (выброшено исключение), опубликованный индекс остаётся прежним, а запасной
+    // экземпляр, который могло частично изменить исключение, отбрасывается.
+    // Так же отбрасывается старый экземпляр, если после публикации повтор
+    // изменения на нём не удался. Отброшенный экземпляр строится заново
+    // перед следующим изменением.
+    template <typename Mutation>
+    void Modify(Mutation mutation);
+};
+
+template <typename StopWordCollection>
+ConcurrentSearchServer::ConcurrentSearchServer(const StopWordCollection& stop_words,
+                                               PostingFormat posting_format)
+    : posting_format_{posting_format},
+      published_{std::make_unique<SearchServer>(stop_words, posting_format)},
+      standby_{std::make_unique<SearchServer>(stop_words, posting_format)}
+{
+    for (const std::string_view word : published_->stop_words_.GetSortedWords()) {
+        stop_words_.emplace_back(word);
+    }
+    Publish();
+}
+
+template <typename Mutation>
+void ConcurrentSearchServer::Modify(Mutation mutation)
+{
+    std::lock_guard guard(write_mutex_);
+    if (!standby_) {
+        RebuildStandby();
+    }
+    try {
+        mutation(*standby_);
+    } catch (...) {
+        // Исключение могло прервать изменение на середине, и тогда запасной
+        // экземпляр уже не совпадает с опубликованным
+        standby_.reset();
+        throw;
+    }
+
+    std::future<void> previous_released = std::move(published_released_);
+    std::swap(published_, standby_);
+    Publish();
+    // Старый экземпляр удерживают только запросы, начатые до публикации
+    previous_released.wait();
+    try {
+        mutation(*standby_);
+    } catch (...) {
+        // Изменение уже опубликовано, а разошедшийся экземпляр
+        // нельзя публиковать следующим
+        standby_.reset();
+    }
+}
+
+template <typename ExecutionPolicy, typename DocumentRange>
+void ConcurrentSearchServer::AddDocuments(ExecutionPolicy&& policy, const DocumentRange& documents)
+{
+    Modify([&policy, &documents](SearchServer& server) {
+        server.AddDocuments(policy, documents);
+    });
+}
+
+template <typename DocumentRange>
+void ConcurrentSearchServer::AddDocuments(const DocumentRange& documents)
+{
+    AddDocuments(std::execution::seq, documents);
+}
+
+template<typename Predicate, typename ExecutionPolicy>
+std::vector<Document>
+ConcurrentSearchServer::FindTopDocuments(ExecutionPolicy&& policy,
+                                         const std::string_view raw_query,
+                                         Predicate predicate,
+                                         size_t result_count) const
+{
+    return GetSnapshot()->FindTopDocuments(policy, raw_query, predicate, result_count);
+}
+
+template<typename Predicate>
+std::vector<Document>
+ConcurrentSearchServer::FindTopDocuments(const std::string_view raw_query,
+                                         Predicate predicate,
+                                         size_t result_count) const
+{
+    return GetSnapshot()->FindTopDocuments(raw_query, predicate, result_count);
+}
+
+template<typename ExecutionPolicy>
+std::vector<Document>
+ConcurrentSearchServer::FindTopDocuments(ExecutionPolicy&& policy,
+                                         const std::string_view raw_query,
+                                         DocumentStatus status,
+                                         size_t result_count) const
+{
+    return GetSnapshot()->FindTopDocuments(policy, raw_query, status, result_count);
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <iostream>
+#include <string_view>
+#include <vector>
 
 struct Document {
     Document() = default;
@@ -18,4 +20,12 @@ enum class DocumentStatus {
     REMOVED
 };
 
+// Документ для пакетного добавления в SearchServer::AddDocuments
+struct RawDocument {
+    int id{};
+    std::string_view text{};
+    DocumentStatus status{DocumentStatus::ACTUAL};
+    std::vector<int> ratings{};
+};
+
 std::ostream& operator<<(std::ostream& output, const Document& document);
@@ -0,0 +1,393 @@
+#include "index_snapshot.h"
+#include "string_processing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'S', 'S', 'R', 'V', 'S', 'N', 'A', 'P'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+uint64_t AlignOffset(uint64_t offset)
+{
+    return (offset + 7) / 8 * 8;
+}
+
+template <typename T>
+void WriteValues(std::ofstream& out, const T* values, size_t count)
+{
+    out.write(reinterpret_cast<const char*>(values),
+              static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+void WritePadding(std::ofstream& out, uint64_t offset)
+{
+    static const char zeros[8] = {};
+    out.write(zeros, static_cast<std::streamsize>(AlignOffset(offset) - offset));
+}
+
+// Умещаются ли count элементов размера element_size, начиная с offset,
+// в limit байт. Считается без переполнения при любых значениях из файла
+bool IsRangeInside(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t limit)
+{
+    return offset <= limit && count <= (limit - offset) / element_size;
+}
+
+// Секция файла: в его границах и выровнена под свой тип
+template <typename T>
+bool IsSectionValid(uint64_t offset, uint64_t count, uint64_t file_size)
+{
+    return offset % alignof(T) == 0 && IsRangeInside(offset, count, sizeof(T), file_size);
+}
+
+} // namespace
+
+struct IndexSnapshot::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t stop_word_count;
+    uint64_t stop_words_offset;
+    uint64_t term_count;
+    uint64_t terms_offset;
+    uint64_t posting_count;
+    uint64_t posting_ids_offset;
+    uint64_t posting_freqs_offset;
+    uint64_t document_count;
+    uint64_t documents_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t file_size;
+};
+
+void IndexSnapshot::Save(const SearchServer& search_server, const std::string& path)
+{
+    const InvertedIndex& index = search_server.index_;
+
+    std::string strings;
+    auto add_string = [&strings](const std::string_view text) {
+        const StringRef ref {strings.size(), text.size()};
+        strings.append(text);
+        return ref;
+    };
+
+    std::vector<StringRef> stop_words;
+    for (const std::string_view word : search_server.stop_words_.GetSortedWords()) {
+        stop_words.push_back(add_string(word));
+    }
+
+    std::vector<InvertedIndex::TermId> term_ids;
+    for (size_t term = 0; term < index.GetTermCount(); ++term) {
+        if (index.Find(static_cast<InvertedIndex::TermId>(term)) != nullptr) {
+            term_ids.push_back(static_cast<InvertedIndex::TermId>(term));
+        }
+    }
+    std::sort(term_ids.begin(), term_ids.end(),
+              [&index](InvertedIndex::TermId lhs, InvertedIndex::TermId rhs) {
+                  return index.GetTerm(lhs) < index.GetTerm(rhs);
+              });
+
+    std::vector<TermEntry> terms;
+    uint64_t posting_count = 0;
+    for (const InvertedIndex::TermId term : term_ids) {
+        const PostingList& postings = *index.Find(term);
+        terms.push_back({add_string(index.GetTerm(term)), posting_count,
+                         postings.size(), postings.log_document_freq});
+        posting_count += postings.size();
+    }
+
+    std::vector<DocumentEntry> documents;
+    for (const auto& [document_id, document] : search_server.documents_) {
+        documents.push_back({document_id, document.rating,
+                             static_cast<int32_t>(document.status), 0});
+    }
+
+    Header header {};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.stop_word_count = stop_words.size();
+    header.stop_words_offset = sizeof(Header);
+    header.term_count = terms.size();
+    header.terms_offset = header.stop_words_offset + stop_words.size() * sizeof(StringRef);
+    header.posting_count = posting_count;
+    header.posting_ids_offset = header.terms_offset + terms.size() * sizeof(TermEntry);
+    header.posting_freqs_offset = AlignOffset(header.posting_ids_offset
+                                              + posting_count * sizeof(int32_t));
+    header.document_count = documents.size();
+    header.documents_offset = header.posting_freqs_offset + posting_count * sizeof(double);
+    header.strings_offset = header.documents_offset + documents.size() * sizeof(DocumentEntry);
+    header.strings_size = strings.size();
+    header.file_size = header.strings_offset + strings.size();
+
+    // Открытые снимки отображают файл в память, поэтому его нельзя
+    // переписывать на месте: новый снимок пишется рядом и заменяет старый
+    const std::string temporary_path = path + ".tmp";
+    std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Не удалось открыть файл снимка индекса для записи");
+    }
+
+    WriteValues(out, &header, 1);
+    WriteValues(out, stop_words.data(), stop_words.size());
+    WriteValues(out, terms.data(), terms.size());
+    for (const InvertedIndex::TermId term : term_ids) {
+        std::vector<int32_t> ids;
+        for (auto cursor = index.Find(term)->GetCursor(); !cursor.AtEnd(); cursor.Next()) {
+            ids.push_back(cursor.DocumentId());
+        }
+        WriteValues(out, ids.data(), ids.size());
+    }
+    WritePadding(out, header.posting_ids_offset + posting_count * sizeof(int32_t));
+    for (const InvertedIndex::TermId term : term_ids) {
+        std::vector<double> freqs;
+        for (auto cursor = index.Find(term)->GetCursor(); !cursor.AtEnd(); cursor.Next()) {
+            freqs.push_back(cursor.TermFreq());
+        }
+        WriteValues(out, freqs.data(), freqs.size());
+    }
+    WriteValues(out, documents.data(), documents.size());
+    WriteValues(out, strings.data(), strings.size());
+
+    out.close();
+    if (!out) {
+        std::remove(temporary_path.c_str());
+        throw std::runtime_error("Не удалось записать снимок индекса");
+    }
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        std::remove(temporary_path.c_str());
+        throw std::runtime_error("Не удалось заменить файл снимка индекса");
+    }
+}
+
+IndexSnapshot::IndexSnapshot(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Не удалось открыть файл снимка индекса");
+    }
+
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error("Файл снимка индекса повреждён");
+    }
+
+    size_ = static_cast<size_t>(file_stat.st_size);
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        size_ = 0;
+        throw std::runtime_error("Не удалось отобразить файл снимка индекса в память");
+    }
+    data_ = static_cast<const char*>(data);
+
+    const auto& header = *reinterpret_cast<const Header*>(data_);
+    if (!IsHeaderValid(header)) {
+        Unmap();
+        throw std::runtime_error("Файл снимка индекса повреждён");
+    }
+
+    stop_words_ = reinterpret_cast<const StringRef*>(data_ + header.stop_words_offset);
+    stop_word_count_ = header.stop_word_count;
+    terms_ = reinterpret_cast<const TermEntry*>(data_ + header.terms_offset);
+    term_count_ = header.term_count;
+    posting_ids_ = reinterpret_cast<const int32_t*>(data_ + header.posting_ids_offset);
+    posting_freqs_ = reinterpret_cast<const double*>(data_ + header.posting_freqs_offset);
+    documents_ = reinterpret_cast<const DocumentEntry*>(data_ + header.documents_offset);
+    document_count_ = header.document_count;
+    log_document_count_ = document_count_ == 0
+            ? 0.0
+            : std::log(static_cast<double>(document_count_));
+
+    if (!AreEntriesValid(header)) {
+        Unmap();
+        throw std::runtime_error("Файл снимка индекса повреждён");
+    }
+}
+
+bool IndexSnapshot::IsHeaderValid(const Header& header) const
+{
+    const uint64_t size = size_;
+    return std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0
+            && header.version == SNAPSHOT_VERSION
+            && header.file_size == size
+            && IsSectionValid<StringRef>(header.stop_words_offset, header.stop_word_count, size)
+            && IsSectionValid<TermEntry>(header.terms_offset, header.term_count, size)
+            && IsSectionValid<int32_t>(header.posting_ids_offset, header.posting_count, size)
+            && IsSectionValid<double>(header.posting_freqs_offset, header.posting_count, size)
+            && IsSectionValid<DocumentEntry>(header.documents_offset, header.document_count, size)
+            && IsRangeInside(header.strings_offset, header.strings_size, 1, size);
+}
+
+bool IndexSnapshot::AreEntriesValid(const Header& header) const
+{
+    const auto is_string_valid = [&header](const StringRef& ref) {
+        return IsRangeInside(ref.offset, ref.size, 1, header.strings_size);
+    };
+    if (!std::all_of(stop_words_, stop_words_ + stop_word_count_, is_string_valid)) {
+        return false;
+    }
+
+    // Проверяются только таблицы фиксированного размера, чтобы открытие не читало
+    // весь файл; id документов из списков проверяются при поиске в FindDocument
+    for (size_t term_index = 0; term_index < term_count_; ++term_index) {
+        const TermEntry& term = terms_[term_index];
+        if (!is_string_valid(term.text)
+                || !IsRangeInside(term.first_posting, term.posting_count, 1, header.posting_count)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+IndexSnapshot::~IndexSnapshot()
+{
+    Unmap();
+}
+
+IndexSnapshot::IndexSnapshot(IndexSnapshot&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+IndexSnapshot& IndexSnapshot::operator=(IndexSnapshot&& other) noexcept
+{
+    if (this != &other) {
+        Unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        stop_words_ = other.stop_words_;
+        stop_word_count_ = std::exchange(other.stop_word_count_, 0);
+        terms_ = other.terms_;
+        term_count_ = std::exchange(other.term_count_, 0);
+        posting_ids_ = other.posting_ids_;
+        posting_freqs_ = other.posting_freqs_;
+        documents_ = other.documents_;
+        document_count_ = std::exchange(other.document_count_, 0);
+        log_document_count_ = other.log_document_count_;
+    }
+    return *this;
+}
+
+std::vector<Document>
+IndexSnapshot::FindTopDocuments(const std::string_view raw_query,
+                                DocumentStatus status,
+                                size_t result_count) const
+{
+    const auto predicate = [status]([[maybe_unused]] int document_id,
+                                    DocumentStatus s,
+                                    [[maybe_unused]] int rating)
+                                    {
+                                        return s == status;
+                                    };
+    return FindTopDocuments(raw_query, predicate, result_count);
+}
+
+int IndexSnapshot::GetDocumentCount() const
+{
+    return static_cast<int>(document_count_);
+}
+
+std::string_view IndexSnapshot::GetString(const StringRef& ref) const
+{
+    const auto& header = *reinterpret_cast<const Header*>(data_);
+    return {data_ + header.strings_offset + ref.offset, static_cast<size_t>(ref.size)};
+}
+
+bool IndexSnapshot::IsStopWord(const std::string_view word) const
+{
+    const StringRef* last = stop_words_ + stop_word_count_;
+    const StringRef* it = std::lower_bound(stop_words_, last, word,
+                                           [this](const StringRef& ref, std::string_view w) {
+                                               return GetString(ref) < w;
+                                           });
+    return it != last && GetString(*it) == word;
+}
+
+const IndexSnapshot::TermEntry* IndexSnapshot::FindTerm(const std::string_view word) const
+{
+    const TermEntry* last = terms_ + term_count_;
+    const TermEntry* it = std::lower_bound(terms_, last, word,
+                                           [this](const TermEntry& term, std::string_view w) {
+                                               return GetString(term.text) < w;
+                                           });
+    return it != last && GetString(it->text) == word ? it : nullptr;
+}
+
+const IndexSnapshot::DocumentEntry* IndexSnapshot::FindDocument(int document_id) const
+{
+    const DocumentEntry* last = documents_ + document_count_;
+    const DocumentEntry* it = std::lower_bound(documents_, last, document_id,
+                                               [](const DocumentEntry& document, int id) {
+                                                   return document.id < id;
+                                               });
+    // Документ из списка, которого нет в таблице или который лежит вне её диапазона id,
+    // означает повреждённый файл: такой id нельзя передавать в накопитель
+    if (it == last || it->id != document_id
+            || document_id < documents_[0].id || document_id > last[-1].id) {
+        throw std::runtime_error("Файл снимка индекса повреждён");
+    }
+    return it;
+}
+
+IndexSnapshot::Query IndexSnapshot::ParseQuery(const std::string_view text) const
+{
+    std::vector<std::string_view> words;
+    if (!SplitIntoValidWords(text, words)) {
+        throw std::invalid_argument("В поисковом запросе недопустимые символы");
+    }
+    Query query;
+    for (const std::string_view word : words) {
+        const SearchServer::QueryWord query_word {SearchServer::ParseQueryWord(word)};
+        if (IsStopWord(word)) continue;
+
+        const TermEntry* term = FindTerm(query_word.data);
+        if (term == nullptr) continue;
+
+        if (query_word.is_minus) {
+            query.minus_terms.push_back(term);
+        } else {
+            query.plus_terms.push_back(term);
+        }
+    }
+
+    for (auto* terms : {&query.minus_terms, &query.plus_terms}) {
+        std::sort(terms->begin(), terms->end());
+        terms->erase(std::unique(terms->begin(), terms->end()), terms->end());
+    }
+    return query;
+}
+
+std::vector<int> IndexSnapshot::FindExcludedDocuments(const Query& query) const
+{
+    std::vector<int> excluded_documents;
+    for (const TermEntry* term : query.minus_terms) {
+        const int32_t* ids = posting_ids_ + term->first_posting;
+        const auto middle = excluded_documents.insert(excluded_documents.end(),
+                                                      ids, ids + term->posting_count);
+        std::inplace_merge(excluded_documents.begin(), middle, excluded_documents.end());
+    }
+    excluded_documents.erase(std::unique(excluded_documents.begin(), excluded_documents.end()),
+                             excluded_documents.end());
+    return excluded_documents;
+}
+
+void IndexSnapshot::Unmap()
+{
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Индекс SearchServer, сохранённый в файл и открытый через mmap только для чтения.
+// Поиск работает прямо по отображённому файлу, без загрузки в память
+// и без повторного разбора документов.
+//
+// Формат файла: заголовок, таблица стоп-слов, таблица слов (упорядочены
+// по возрастанию), массивы id документов и частот для всех слов подряд,
+// таблица документов (по возрастанию id) и общий пул строк.
+// Числа записываются в порядке байт текущей платформы.
+// При открытии проверяются заголовок, строки и границы списков слов;
+// id документов в списках проверяются по мере того, как их читает поиск.
+class IndexSnapshot {
+public:
+    explicit IndexSnapshot(const std::string& path);
+    ~IndexSnapshot();
+
+    IndexSnapshot(IndexSnapshot&& other) noexcept;
+    IndexSnapshot& operator=(IndexSnapshot&& other) noexcept;
+    IndexSnapshot(const IndexSnapshot&) = delete;
+    IndexSnapshot& operator=(const IndexSnapshot&) = delete;
+
+    static void Save(const SearchServer& search_server, const std::string& path);
+
+    template<typename Predicate>
+    std::vector<Document>
+    FindTopDocuments(const std::string_view raw_query, Predicate predicate,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document>
+    FindTopDocuments(const std::string_view raw_query,
+                     DocumentStatus status = DocumentStatus::ACTUAL,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    int GetDocumentCount() const;
+
+private:
+    struct Header;
+
+    struct StringRef {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct TermEntry {
+        StringRef text;
+        uint64_t first_posting;
+        uint64_t posting_count;
+        double log_document_freq;
+    };
+
+    struct DocumentEntry {
+        int32_t id;
+        int32_t rating;
+        int32_t status;
+        int32_t reserved;
+    };
+
+    struct Query {
+        std::vector<const TermEntry*> plus_terms;
+        std::vector<const TermEntry*> minus_terms;
+    };
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+    const StringRef* stop_words_ = nullptr;
+    size_t stop_word_count_ = 0;
+    const TermEntry* terms_ = nullptr;
+    size_t term_count_ = 0;
+    const int32_t* posting_ids_ = nullptr;
+    const double* posting_freqs_ = nullptr;
+    const DocumentEntry* documents_ = nullptr;
+    size_t document_count_ = 0;
+    double log_document_count_ = 0.0;
+
+    // Проверка границ секций по заголовку и затем строк и слов в них
+    bool IsHeaderValid(const Header& header) const;
+    bool AreEntriesValid(const Header& header) const;
+
+    std::string_view GetString(const StringRef& ref) const;
+    bool IsStopWord(const std::string_view word) const;
+    const TermEntry* FindTerm(const std::string_view word) const;
+    // Выбрасывает runtime_error, если документа нет в таблице
+    const DocumentEntry* FindDocument(int document_id) const;
+
+    Query ParseQuery(const std::string_view text) const;
+    std::vector<int> FindExcludedDocuments(const Query& query) const;
+    void Unmap();
+};
+
+template<typename Predicate>
+std::vector<Document>
+IndexSnapshot::FindTopDocuments(const std::string_view raw_query,
+                                Predicate predicate,
+                                size_t result_count) const
+{
+    const Query query = ParseQuery(raw_query);
+    if (document_count_ == 0) return {};
+
+    const std::vector<int> excluded_documents = FindExcludedDocuments(query);
+
+    const int first_id = documents_[0].id;
+    const auto width = static_cast<size_t>(
+                static_cast<int64_t>(documents_[document_count_ - 1].id) - first_id + 1);
+    // Накопитель создаётся заново для каждого запроса, поэтому плотный массив
+    // выбирается, только если попаданий достаточно много, чтобы окупить его заполнение
+    size_t posting_count = 0;
+    for (const TermEntry* term : query.plus_terms) {
+        posting_count += term->posting_count;
+    }
+    const bool dense = width <= 4 * document_count_ && width <= 16 * posting_count;
+    RelevanceAccumulator accumulator(first_id, width, dense);
+
+    for (const TermEntry* term : query.plus_terms) {
+        const double inverse_document_freq = log_document_count_ - term->log_document_freq;
+        const int32_t* ids = posting_ids_ + term->first_posting;
+        const double* freqs = posting_freqs_ + term->first_posting;
+
+        auto excluded = excluded_documents.begin();
+        for (size_t i = 0; i < term->posting_count; ++i) {
+            const int document_id = ids[i];
+            while (excluded != excluded_documents.end() && *excluded < document_id) {
+                ++excluded;
+            }
+            if (excluded != excluded_documents.end() && *excluded == document_id) continue;
+
+            const DocumentEntry* document = FindDocument(document_id);
+            if (predicate(document_id, static_cast<DocumentStatus>(document->status),
+                          document->rating)) {
+                accumulator.Add(document_id, freqs[i] * inverse_document_freq);
+            }
+        }
+    }
+
+    std::vector<Document> matched_documents;
+    accumulator.ForEach([this, &matched_documents](int document_id, double relevance) {
+        matched_documents.emplace_back(document_id, relevance, FindDocument(document_id)->rating);
+    });
+
+    const size_t top_count = std::min(matched_documents.size(), result_count);
+    std::partial_sort(matched_documents.begin(),
+                      matched_documents.begin() + static_cast<ptrdiff_t>(top_count),
+                      matched_documents.end(),
+                      SearchServer::IsMoreRelevant);
+    matched_documents.resize(top_count);
+    return matched_documents;
+}
@@ -0,0 +1,330 @@
+#include "inverted_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+size_t PostingList::size() const
+{
+    return is_compressed ? compressed->size() : document_ids.size();
+}
+
+bool PostingList::empty() const
+{
+    return size() == 0;
+}
+
+PostingList::Cursor PostingList::GetCursor() const
+{
+    return Cursor{*this};
+}
+
+PostingList::Cursor::Cursor(const PostingList& postings)
+    : postings_{&postings}
+{
+    if (postings_->is_compressed && !postings_->empty()) {
+        block_ids_.resize(CompressedPostings::BLOCK_SIZE);
+        LoadBlock(0);
+    }
+}
+
+void PostingList::Cursor::Seek(int document_id)
+{
+    if (AtEnd() || DocumentId() >= document_id) return;
+
+    if (!postings_->is_compressed) {
+        const auto& ids = postings_->document_ids;
+        position_ = static_cast<size_t>(
+                    std::lower_bound(ids.begin() + static_cast<ptrdiff_t>(position_),
+                                     ids.end(), document_id) - ids.begin());
+        return;
+    }
+
+    // Первый блок, последний id которого не меньше document_id,
+    // ищется двоичным поиском по оставшимся блокам
+    const CompressedPostings& compressed = *postings_->compressed;
+    size_t block = block_;
+    size_t last_block = compressed.GetBlockCount();
+    while (block < last_block) {
+        const size_t middle = block + (last_block - block) / 2;
+        if (compressed.GetBlockLastDocumentId(middle) < document_id) {
+            block = middle + 1;
+        } else {
+            last_block = middle;
+        }
+    }
+    if (block == compressed.GetBlockCount()) {
+        position_ = postings_->size();
+        return;
+    }
+    if (block != block_) {
+        LoadBlock(block);
+    }
+    const auto block_ids_end = block_ids_.begin() + static_cast<ptrdiff_t>(block_end_ - block_begin_);
+    position_ = block_begin_ + static_cast<size_t>(
+                std::lower_bound(block_ids_.begin() + static_cast<ptrdiff_t>(position_ - block_begin_),
+                                 block_ids_end, document_id) - block_ids_.begin());
+}
+
+void PostingList::Cursor::LoadBlock(size_t block)
+{
+    block_ = block;
+    block_begin_ = block * CompressedPostings::BLOCK_SIZE;
+    block_end_ = block_begin_ + postings_->compressed->DecodeBlock(block, block_ids_.data());
+    position_ = block_begin_;
+}
+
+namespace {
+
+int GetLastDocumentId(const PostingList& list)
+{
+    if (!list.is_compressed) return list.document_ids.back();
+    return list.compressed->GetBlockLastDocumentId(list.compressed->GetBlockCount() - 1);
+}
+
+void Unpack(PostingList& list)
+{
+    if (list.is_compressed) {
+        list.compressed->Decode(list.document_ids, list.term_freqs);
+    }
+}
+
+void Pack(PostingList& list)
+{
+    if (list.is_compressed) {
+        list.compressed->Assign(list.document_ids, list.term_freqs);
+        std::vector<int>{}.swap(list.document_ids);
+        std::vector<double>{}.swap(list.term_freqs);
+    }
+    list.log_document_freq = list.empty() ? 0.0 : std::log(static_cast<double>(list.size()));
+}
+
+} // namespace
+
+InvertedIndex::InvertedIndex(PostingFormat format)
+    : format_{format}
+{
+}
+
+InvertedIndex::TermId InvertedIndex::AddTerm(const std::string_view term)
+{
+    if (const auto it = term_ids_.find(term); it != term_ids_.end()) {
+        return it->second;
+    }
+    const std::string_view stored = term_texts_.Store(term);
+    TermId id;
+    if (free_terms_.empty()) {
+        id = static_cast<TermId>(terms_.size());
+        terms_.push_back(stored);
+        postings_.emplace_back();
+    } else {
+        id = free_terms_.back();
+        free_terms_.pop_back();
+        terms_[id] = stored;
+    }
+    term_ids_.emplace(stored, id);
+    PostingList& list = postings_[id];
+    list.is_compressed = format_ == PostingFormat::COMPRESSED;
+    if (list.is_compressed && !list.compressed) {
+        list.compressed = std::make_unique<CompressedPostings>();
+    }
+    return id;
+}
+
+InvertedIndex::TermId InvertedIndex::FindTerm(const std::string_view term) const
+{
+    const auto it = term_ids_.find(term);
+    return it == term_ids_.end() ? NO_TERM : it->second;
+}
+
+std::string_view InvertedIndex::GetTerm(TermId term) const
+{
+    return terms_[term];
+}
+
+size_t InvertedIndex::GetTermCount() const
+{
+    return terms_.size();
+}
+
+void InvertedIndex::Add(TermId term, int document_id, double term_freq)
+{
+    PostingList& list = postings_[term];
+    list.max_term_freq = std::max(list.max_term_freq, term_freq);
+    if (list.empty() || GetLastDocumentId(list) < document_id) {
+        if (list.is_compressed) {
+            list.compressed->Append(document_id, term_freq);
+        } else {
+            list.document_ids.push_back(document_id);
+            list.term_freqs.push_back(term_freq);
+        }
+        list.log_document_freq = std::log(static_cast<double>(list.size()));
+        return;
+    }
+
+    Unpack(list);
+    const auto pos = std::lower_bound(list.document_ids.begin(),
+                                      list.document_ids.end(),
+                                      document_id);
+    const auto offset = std::distance(list.document_ids.begin(), pos);
+    if (pos != list.document_ids.end() && *pos == document_id) {
+        list.term_freqs[offset] = term_freq;
+    } else {
+        list.document_ids.insert(pos, document_id);
+        list.term_freqs.insert(std::next(list.term_freqs.begin(), offset), term_freq);
+    }
+    Pack(list);
+}
+
+void InvertedIndex::AddSorted(std::vector<Posting>::const_iterator first,
+                              std::vector<Posting>::const_iterator last)
+{
+    if (first == last) return;
+
+    PostingList& list = postings_[first->term];
+    const auto count = static_cast<size_t>(std::distance(first, last));
+    for (auto it = first; it != last; ++it) {
+        list.max_term_freq = std::max(list.max_term_freq, it->term_freq);
+    }
+
+    if (list.is_compressed && (list.empty() || GetLastDocumentId(list) < first->document_id)) {
+        for (auto it = first; it != last; ++it) {
+            list.compressed->Append(it->document_id, it->term_freq);
+        }
+        list.log_document_freq = std::log(static_cast<double>(list.size()));
+        return;
+    }
+
+    Unpack(list);
+    if (list.document_ids.empty() || list.document_ids.back() < first->document_id) {
+        list.document_ids.reserve(list.document_ids.size() + count);
+        list.term_freqs.reserve(list.term_freqs.size() + count);
+        for (auto it = first; it != last; ++it) {
+            list.document_ids.push_back(it->document_id);
+            list.term_freqs.push_back(it->term_freq);
+        }
+    } else {
+        std::vector<int> merged_ids;
+        std::vector<double> merged_freqs;
+        merged_ids.reserve(list.document_ids.size() + count);
+        merged_freqs.reserve(list.document_ids.size() + count);
+        size_t i = 0;
+        for (auto it = first; it != last || i < list.document_ids.size();) {
+            if (it == last || (i < list.document_ids.size()
+                               && list.document_ids[i] < it->document_id)) {
+                merged_ids.push_back(list.document_ids[i]);
+                merged_freqs.push_back(list.term_freqs[i]);
+                ++i;
+            } else {
+                merged_ids.push_back(it->document_id);
+                merged_freqs.push_back(it->term_freq);
+                ++it;
+            }
+        }
+        list.document_ids = std::move(merged_ids);
+        list.term_freqs = std::move(merged_freqs);
+    }
+    Pack(list);
+}
+
+void InvertedIndex::RemoveSorted(std::vector<Posting>::const_iterator first,
+                                 std::vector<Posting>::const_iterator last)
+{
+    if (first == last) return;
+
+    PostingList& list = postings_[first->term];
+    Unpack(list);
+    size_t kept = 0;
+    double max_term_freq = 0.0;
+    for (size_t i = 0; i < list.document_ids.size(); ++i) {
+        while (first != last && first->document_id < list.document_ids[i]) {
+            ++first;
+        }
+        if (first != last && first->document_id == list.document_ids[i]) continue;
+
+        list.document_ids[kept] = list.document_ids[i];
+        list.term_freqs[kept] = list.term_freqs[i];
+        max_term_freq = std::max(max_term_freq, list.term_freqs[i]);
+        ++kept;
+    }
+    list.document_ids.resize(kept);
+    list.term_freqs.resize(kept);
+    list.max_term_freq = max_term_freq;
+    Pack(list);
+}
+
+bool InvertedIndex::RemoveEmptyTerms(const std::vector<TermId>& terms)
+{
+    for (const TermId term : terms) {
+        if (terms_[term].empty() || !postings_[term].empty()) continue;
+
+        term_ids_.erase(terms_[term]);
+        removed_term_text_size_ += terms_[term].size();
+        terms_[term] = {};
+        postings_[term] = PostingList{};
+        free_terms_.push_back(term);
+    }
+
+    // Строки перекладываются в новое хранилище, когда больше половины
+    // занятой памяти приходится на удалённые слова
+    if (removed_term_text_size_ < TextArena::DEFAULT_CHUNK_SIZE
+            || 2 * removed_term_text_size_ < term_texts_.GetStoredSize()) {
+        return false;
+    }
+
+    TextArena texts;
+    term_ids_.clear();
+    for (size_t term = 0; term < terms_.size(); ++term) {
+        if (terms_[term].empty()) continue;
+        terms_[term] = texts.Store(terms_[term]);
+        term_ids_.emplace(terms_[term], static_cast<TermId>(term));
+    }
+    term_texts_ = std::move(texts);
+    removed_term_text_size_ = 0;
+    return true;
+}
+
+const PostingList* InvertedIndex::Find(TermId term) const
+{
+    if (term >= postings_.size() || postings_[term].empty()) return nullptr;
+    return &postings_[term];
+}
+
+bool InvertedIndex::Contains(TermId term, int document_id) const
+{
+    const PostingList* list = Find(term);
+    if (list == nullptr) return false;
+
+    if (!list->is_compressed) {
+        return std::binary_search(list->document_ids.begin(), list->document_ids.end(),
+                                  document_id);
+    }
+    PostingList::Cursor cursor = list->GetCursor();
+    cursor.Seek(document_id);
+    return !cursor.AtEnd() && cursor.DocumentId() == document_id;
+}
+
+void InvertedIndex::SetDocumentCount(size_t document_count)
+{
+    log_document_count_ = document_count == 0
+            ? 0.0
+            : std::log(static_cast<double>(document_count));
+}
+
+double InvertedIndex::GetInverseDocumentFreq(const PostingList& postings) const
+{
+    return log_document_count_ - postings.log_document_freq;
+}
+
+size_t InvertedIndex::GetPostingsMemoryUsage() const
+{
+    size_t usage = postings_.capacity() * sizeof(PostingList);
+    for (const PostingList& list : postings_) {
+        usage += list.document_ids.capacity() * sizeof(int)
+                + list.term_freqs.capacity() * sizeof(double);
+        if (list.compressed) {
+            usage += sizeof(CompressedPostings) + list.compressed->GetMemoryUsage();
+        }
+    }
+    return usage;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "compressed_postings.h"
+#include "text_arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum class PostingFormat {
+    PLAIN,
+    COMPRESSED
+};
+
+// Список документов, содержащих слово. Идентификаторы документов
+// упорядочены по возрастанию, частоты хранятся в отдельном массиве
+// с теми же индексами. В формате COMPRESSED вместо массивов используется
+// compressed; у списков формата PLAIN он не создаётся, чтобы не занимать
+// место в каждом списке. max_term_freq ограничивает сверху любую частоту
+// из списка и используется для отсечения документов при поиске.
+// log_document_freq - закэшированный логарифм длины списка для расчёта IDF.
+struct PostingList {
+    std::vector<int> document_ids;
+    std::vector<double> term_freqs;
+    std::unique_ptr<CompressedPostings> compressed;
+    bool is_compressed = false;
+    double max_term_freq = 0.0;
+    double log_document_freq = 0.0;
+
+    size_t size() const;
+    bool empty() const;
+
+    // Последовательный обход списка с переходом к заданному id.
+    // Сжатый список распаковывается по одному блоку; буфер под блок
+    // заводится только у курсоров сжатых списков.
+    class Cursor {
+    public:
+        explicit Cursor(const PostingList& postings);
+
+        bool AtEnd() const;
+        int DocumentId() const;
+        double TermFreq() const;
+        void Next();
+        // Переходит к первому документу с id не меньше document_id
+        void Seek(int document_id);
+
+    private:
+        const PostingList* postings_;
+        size_t position_ = 0;
+        size_t block_ = 0;
+        size_t block_begin_ = 0;
+        size_t block_end_ = 0;
+        std::vector<int> block_ids_{};
+
+        void LoadBlock(size_t block);
+    };
+
+    Cursor GetCursor() const;
+};
+
+inline bool PostingList::Cursor::AtEnd() const
+{
+    return position_ == postings_->size();
+}
+
+inline int PostingList::Cursor::DocumentId() const
+{
+    return postings_->is_compressed
+            ? block_ids_[position_ - block_begin_]
+            : postings_->document_ids[position_];
+}
+
+inline double PostingList::Cursor::TermFreq() const
+{
+    return postings_->is_compressed
+            ? postings_->compressed->GetTermFreq(position_)
+            : postings_->term_freqs[position_];
+}
+
+inline void PostingList::Cursor::Next()
+{
+    ++position_;
+    if (postings_->is_compressed && position_ == block_end_ && !AtEnd()) {
+        LoadBlock(block_ + 1);
+    }
+}
+
+// Каждому слову при первом добавлении назначается плотный номер TermId,
+// по которому хранятся списки документов. Строки слов принадлежат индексу
+// и не перемещаются, пока он существует.
+class InvertedIndex {
+public:
+    using TermId = uint32_t;
+    static constexpr TermId NO_TERM = UINT32_MAX;
+
+    explicit InvertedIndex(PostingFormat format = PostingFormat::PLAIN);
+
+    TermId AddTerm(const std::string_view term);
+    TermId FindTerm(const std::string_view term) const;
+    std::string_view GetTerm(TermId term) const;
+    // Номера слов лежат в [0, GetTermCount()), среди них могут быть освобождённые
+    size_t GetTermCount() const;
+
+    struct Posting {
+        TermId term;
+        int document_id;
+        double term_freq;
+    };
+
+    void Add(TermId term, int document_id, double term_freq);
+    // Добавляет пачку записей одного слова, упорядоченных по id документа.
+    // Для разных слов можно вызывать одновременно из нескольких потоков.
+    void AddSorted(std::vector<Posting>::const_iterator first,
+                   std::vector<Posting>::const_iterator last);
+    // Удаляет из списка одного слова пачку документов, упорядоченных по id,
+    // за один проход по списку. Для разных слов можно вызывать одновременно
+    // из нескольких потоков.
+    void RemoveSorted(std::vector<Posting>::const_iterator first,
+                      std::vector<Posting>::const_iterator last);
+    // Освобождает слова с пустыми списками: их номера достаются новым словам,
+    // а строки перестают храниться. Возвращает true, если строки остальных
+    // слов переложены в новое хранилище и полученные ранее string_view
+    // на них недействительны.
+    bool RemoveEmptyTerms(const std::vector<TermId>& terms);
+
+    const PostingList* Find(TermId term) const;
+    bool Contains(TermId term, int document_id) const;
+
+    // IDF пересчитывается без логарифмов: log(N / df) = log(N) - log(df),
+    // где оба логарифма обновляются только при изменении индекса
+    void SetDocumentCount(size_t document_count);
+    double GetInverseDocumentFreq(const PostingList& postings) const;
+
+    // Память, занятая списками документов всех слов
+    size_t GetPostingsMemoryUsage() const;
+
+private:
+    PostingFormat format_;
+    double log_document_count_ = 0.0;
+
+    TextArena term_texts_{};
+    // У освобождённого слова пустая строка
+    std::vector<std::string_view> terms_{};
+    std::unordered_map<std::string_view, TermId> term_ids_{};
+    std::vector<PostingList> postings_{};
+    std::vector<TermId> free_terms_{};
+    size_t removed_term_text_size_ = 0;
+};
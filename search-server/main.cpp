@@ -1,5 +1,7 @@
+#include "log_duration.h"
 #include "process_queries.h"
 #include "search_server.h"
+#include "sharded_search_server.h"
 #include "test_example_functions.h"
 
 #include <execution>
@@ -56,8 +58,8 @@ vector<string> GenerateQueries(mt19937& generator, const vector<string>& diction
     }
     return queries;
 }
-template <typename ExecutionPolicy>
-void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
+template <typename Server, typename ExecutionPolicy>
+void Test(string_view mark, const Server& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
     LOG_DURATION(mark);
     double total_relevance = 0;
     for (const string_view query : queries) {
@@ -70,6 +72,17 @@ void Test(string_view mark, const SearchServer& search_server, const vector<stri
 }
 #define TEST(policy) Test(#policy, search_server, queries, std::execution::policy)
 
+void TestWithPruning(string_view mark, const SearchServer& search_server, const vector<string>& queries) {
+    LOG_DURATION(mark);
+    double total_relevance = 0;
+    for (const string_view query : queries) {
+        for (const auto& document : search_server.FindTopDocumentsWithPruning(query)) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+
 
 int main() {
     TestSearchServer();
@@ -121,6 +134,33 @@ int main() {
 
         TEST(seq);
         TEST(par);
+        TestWithPruning("pruning"sv, search_server, queries);
+    }
+
+    {
+        mt19937 generator;
+        const auto dictionary = GenerateDictionary(generator, 1000, 10);
+        const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+        SearchServer search_server(dictionary[0], PostingFormat::COMPRESSED);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        const auto queries = GenerateQueries(generator, dictionary, 100, 70);
+
+        Test("compressed seq"sv, search_server, queries, execution::seq);
+    }
+
+    {
+        mt19937 generator;
+        const auto dictionary = GenerateDictionary(generator, 1000, 10);
+        const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+        ShardedSearchServer search_server(dictionary[0]);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        const auto queries = GenerateQueries(generator, dictionary, 100, 70);
+
+        Test("sharded par"sv, search_server, queries, execution::par);
     }
 
     return 0;
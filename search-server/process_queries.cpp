@@ -1,33 +1,46 @@
 #include "process_queries.h"
 
 #include <execution>
-#include <iostream>
-#include <iterator>
-#include <numeric>
+
+size_t JoinedDocuments::GetQueryCount() const
+{
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+Page<std::vector<Document>::const_iterator> JoinedDocuments::GetQueryDocuments(size_t query) const
+{
+    return {documents.begin() + static_cast<std::ptrdiff_t>(offsets.at(query)),
+            documents.begin() + static_cast<std::ptrdiff_t>(offsets.at(query + 1))};
+}
 
 std::vector<std::vector<Document>> ProcessQueries(
         const SearchServer& search_server,
         const std::vector<std::string>& queries)
 {
-    std::vector<std::vector<Document>> result(queries.size());
-    std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(),
-                   [&search_server](const std::string& query) {
-                   return search_server.FindTopDocuments(query);
-                   });
-    return result;
+    return search_server.FindTopDocumentsBatch(std::execution::par, queries);
 }
-std::vector<Document> ProcessQueriesJoined(
+
+std::vector<std::vector<Document>> ProcessQueries(
+        ThreadPool& pool,
         const SearchServer& search_server,
         const std::vector<std::string>& queries)
 {
-    std::vector<std::vector<Document>> responses {ProcessQueries(search_server, queries)};
-    std::vector<Document> result = std::reduce(std::execution::par,
-                                               responses.begin(), responses.end(),
-                                               std::vector<Document>{},
-                                               [](std::vector<Document> a, const std::vector<Document> b) {
-                                               a.insert(a.end(), b.begin(), b.end());
-                                               return a;
-                                               });
+    return search_server.FindTopDocumentsBatch(ThreadPoolPolicy{pool}, queries);
+}
 
-    return result;
+JoinedDocuments ProcessQueriesFlat(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries)
+{
+    JoinedDocuments joined;
+    search_server.FindTopDocumentsBatch(std::execution::par, queries,
+                                        joined.documents, joined.offsets);
+    return joined;
+}
+
+std::vector<Document> ProcessQueriesJoined(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries)
+{
+    return ProcessQueriesFlat(search_server, queries).documents;
 }
@@ -1,14 +1,39 @@
 #pragma once
 
 #include "document.h"
+#include "paginator.h"
 #include "search_server.h"
+#include "thread_pool.h"
 
+#include <cstddef>
 #include <vector>
 
+// Результаты нескольких запросов в одном массиве: документы запроса i
+// лежат в documents с offsets[i] по offsets[i + 1]
+struct JoinedDocuments {
+    std::vector<Document> documents{};
+    std::vector<size_t> offsets{0};
+
+    size_t GetQueryCount() const;
+    Page<std::vector<Document>::const_iterator> GetQueryDocuments(size_t query) const;
+};
+
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
 
+// То же, но запросы выполняются потоками pool
+std::vector<std::vector<Document>> ProcessQueries(
+    ThreadPool& pool,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+// Документы всех запросов записываются сразу в общий массив,
+// без отдельного массива на каждый запрос
+JoinedDocuments ProcessQueriesFlat(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
 std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
@@ -0,0 +1,81 @@
+#include "query_cache.h"
+
+#include <algorithm>
+#include <functional>
+
+QueryCache::QueryCache(const SearchServer& search_server, size_t capacity)
+    : server_{search_server},
+      shard_capacity_{std::max<size_t>(1, (capacity + SHARD_COUNT - 1) / SHARD_COUNT)}
+{
+}
+
+std::vector<Document>
+QueryCache::FindTopDocuments(const std::string_view raw_query,
+                             DocumentStatus status,
+                             size_t result_count)
+{
+    std::string key = server_.GetQueryKey(raw_query);
+    key.push_back(static_cast<char>(status));
+    key.append(reinterpret_cast<const char*>(&result_count), sizeof(result_count));
+
+    const uint64_t epoch = server_.GetEpoch();
+    Shard& shard = shards_[std::hash<std::string>{}(key) % SHARD_COUNT];
+    {
+        std::lock_guard guard(shard.mutex);
+        const auto it = shard.positions.find(key);
+        if (it != shard.positions.end() && it->second->epoch == epoch) {
+            shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+            ++hit_count_;
+            return it->second->documents;
+        }
+    }
+
+    // Поиск выполняется без блокировки; одновременные промахи по одному
+    // запросу просто вычислят его несколько раз
+    ++miss_count_;
+    std::vector<Document> documents = server_.FindTopDocuments(raw_query, status, result_count);
+
+    std::lock_guard guard(shard.mutex);
+    if (const auto it = shard.positions.find(key); it != shard.positions.end()) {
+        it->second->epoch = epoch;
+        it->second->documents = documents;
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return documents;
+    }
+    Entry& entry = shard.entries.emplace_front(Entry{std::move(key), epoch, documents});
+    shard.positions.emplace(entry.key, shard.entries.begin());
+    if (shard.entries.size() > shard_capacity_) {
+        shard.positions.erase(shard.entries.back().key);
+        shard.entries.pop_back();
+    }
+    return documents;
+}
+
+uint64_t QueryCache::GetHitCount() const
+{
+    return hit_count_;
+}
+
+uint64_t QueryCache::GetMissCount() const
+{
+    return miss_count_;
+}
+
+size_t QueryCache::GetSize() const
+{
+    size_t size = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        size += shard.entries.size();
+    }
+    return size;
+}
+
+void QueryCache::Clear()
+{
+    for (Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        shard.positions.clear();
+        shard.entries.clear();
+    }
+}
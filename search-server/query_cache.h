@@ -0,0 +1,62 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Кэш результатов поиска SearchServer с вытеснением давно не запрашивавшихся
+// результатов (LRU). Запросы сравниваются по SearchServer::GetQueryKey,
+// поэтому порядок слов, повторы и стоп-слова на попадание не влияют.
+// Результат, полученный при другой версии индекса (SearchServer::GetEpoch),
+// считается устаревшим и вычисляется заново. Кэш разделён на части со
+// своими блокировками, поэтому запросы можно выполнять из нескольких потоков,
+// пока индекс не изменяется. Кэшируются только запросы по статусу документа:
+// произвольные предикаты нельзя сравнить между собой.
+class QueryCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+    explicit QueryCache(const SearchServer& search_server, size_t capacity = DEFAULT_CAPACITY);
+
+    std::vector<Document>
+    FindTopDocuments(const std::string_view raw_query,
+                     DocumentStatus status = DocumentStatus::ACTUAL,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    uint64_t GetHitCount() const;
+    uint64_t GetMissCount() const;
+    size_t GetSize() const;
+    void Clear();
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Entry {
+        std::string key;
+        uint64_t epoch;
+        std::vector<Document> documents;
+    };
+
+    // Записи от недавно использованных к давно использованным
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> positions;
+    };
+
+    const SearchServer& server_;
+    size_t shard_capacity_;
+    std::array<Shard, SHARD_COUNT> shards_{};
+    std::atomic<uint64_t> hit_count_{0};
+    std::atomic<uint64_t> miss_count_{0};
+};
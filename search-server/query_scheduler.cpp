@@ -0,0 +1,206 @@
+#include "query_scheduler.h"
+
+#include <algorithm>
+#include <execution>
+#include <stdexcept>
+#include <utility>
+
+CancellationToken::CancellationToken()
+    : cancelled_{std::make_shared<std::atomic<bool>>(false)}
+{
+}
+
+void CancellationToken::Cancel()
+{
+    cancelled_->store(true);
+}
+
+bool CancellationToken::IsCancelled() const
+{
+    return cancelled_->load();
+}
+
+bool QueryBudget::IsExpired() const
+{
+    return token.IsCancelled() || std::chrono::steady_clock::now() >= deadline;
+}
+
+QueryEvaluation::Traversal QueryEvaluation::Traversal::promise_type::get_return_object()
+{
+    return {std::coroutine_handle<promise_type>::from_promise(*this)};
+}
+
+QueryEvaluation::QueryEvaluation(const SearchServer& server,
+                                 const std::string_view raw_query,
+                                 DocumentStatus status,
+                                 size_t result_count)
+    : server_{server},
+      status_{status},
+      result_count_{result_count}
+{
+    const SearchServer::Query query = server_.ParseQuery(raw_query);
+    if (!server_.documents_id_.empty()) {
+        server_.FindExcludedDocuments(query, excluded_documents_);
+        size_t posting_count = 0;
+        for (const SearchServer::TermId term : query.plus_terms) {
+            if (const PostingList* postings = server_.index_.Find(term)) {
+                plus_postings_.push_back(postings);
+                inverse_document_freqs_.push_back(server_.index_.GetInverseDocumentFreq(*postings));
+                posting_count += postings->size();
+            }
+        }
+
+        std::vector<SearchServer::DocumentIdRange> ranges;
+        server_.SplitDocumentIdRange(1, ranges);
+        range_ = ranges.front();
+        // Накопитель заводится на один запрос, поэтому плотный массив
+        // берётся, только если записей достаточно, чтобы окупить его заполнение
+        range_.dense = range_.dense && range_.width() <= 16 * posting_count;
+        accumulator_.Reset(range_.first, range_.width(), range_.dense);
+    }
+    traversal_ = Traverse().handle;
+}
+
+QueryEvaluation::~QueryEvaluation()
+{
+    traversal_.destroy();
+}
+
+QueryEvaluation::Traversal QueryEvaluation::Traverse()
+{
+    const auto predicate = [this]([[maybe_unused]] int document_id,
+                                  DocumentStatus status,
+                                  [[maybe_unused]] int rating) {
+        return status == status_;
+    };
+    for (size_t word = 0; word < plus_postings_.size(); ++word) {
+        PostingList::Cursor cursor = plus_postings_[word]->GetCursor();
+        auto excluded = excluded_documents_.cbegin();
+        while (true) {
+            posting_budget_ -= server_.ScorePostings(cursor, range_.last,
+                                                     inverse_document_freqs_[word],
+                                                     excluded_documents_, excluded, predicate,
+                                                     accumulator_, posting_budget_);
+            if (cursor.AtEnd()) break;
+            co_await std::suspend_always{};
+        }
+    }
+}
+
+bool QueryEvaluation::Resume(size_t posting_count)
+{
+    if (posting_count == 0) {
+        throw std::invalid_argument("Часть поиска должна содержать хотя бы одну запись");
+    }
+    if (!traversal_.done()) {
+        posting_budget_ = posting_count;
+        traversal_.resume();
+    }
+    return traversal_.done();
+}
+
+bool QueryEvaluation::IsFinished() const
+{
+    return traversal_.done();
+}
+
+TopDocuments QueryEvaluation::GetTopDocuments()
+{
+    TopDocuments result;
+    result.is_partial = !IsFinished();
+    accumulator_.ForEach([this, &result](int document_id, double relevance) {
+        result.documents.emplace_back(document_id, relevance,
+                                      server_.documents_.at(document_id).rating);
+    });
+    std::vector<Document> candidates;
+    SearchServer::SelectTopDocuments(std::execution::seq, result.documents, candidates,
+                                     result_count_);
+    return result;
+}
+
+QueryScheduler::Task::Task(const SearchServer& server, const std::string_view raw_query,
+                           QueryBudget budget, DocumentStatus status, size_t result_count)
+    : evaluation{server, raw_query, status, result_count},
+      budget{std::move(budget)}
+{
+}
+
+QueryScheduler::QueryScheduler(size_t slice_size)
+    : slice_size_{slice_size}
+{
+    if (slice_size_ == 0) {
+        throw std::invalid_argument("Часть поиска должна содержать хотя бы одну запись");
+    }
+    thread_ = std::thread(&QueryScheduler::Run, this);
+}
+
+QueryScheduler::~QueryScheduler()
+{
+    {
+        std::lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    task_added_.notify_all();
+    thread_.join();
+}
+
+std::future<TopDocuments> QueryScheduler::Submit(const SearchServer& server,
+                                                 const std::string_view raw_query,
+                                                 QueryBudget budget,
+                                                 DocumentStatus status,
+                                                 size_t result_count)
+{
+    auto task = std::make_unique<Task>(server, raw_query, std::move(budget), status, result_count);
+    std::future<TopDocuments> result = task->result.get_future();
+    {
+        std::lock_guard guard(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    task_added_.notify_one();
+    return result;
+}
+
+void QueryScheduler::Run()
+{
+    while (true) {
+        std::unique_ptr<Task> task;
+        {
+            std::unique_lock lock(mutex_);
+            task_added_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (stopping_) {
+                // Незавершённые поиски отдают то, что успели найти
+                for (const auto& unfinished : tasks_) {
+                    unfinished->result.set_value(unfinished->evaluation.GetTopDocuments());
+                }
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        if (task->budget.IsExpired() || task->evaluation.Resume(slice_size_)) {
+            task->result.set_value(task->evaluation.GetTopDocuments());
+            continue;
+        }
+
+        std::lock_guard guard(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+}
+
+TopDocuments FindTopDocumentsWithBudget(const SearchServer& server,
+                                        const std::string_view raw_query,
+                                        const QueryBudget& budget,
+                                        DocumentStatus status,
+                                        size_t result_count,
+                                        size_t posting_count)
+{
+    if (posting_count == 0) {
+        throw std::invalid_argument("Часть поиска должна содержать хотя бы одну запись");
+    }
+    QueryEvaluation evaluation(server, raw_query, status, result_count);
+    while (!evaluation.Resume(posting_count)) {
+        if (budget.IsExpired()) break;
+    }
+    return evaluation.GetTopDocuments();
+}
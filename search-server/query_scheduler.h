@@ -0,0 +1,151 @@
+#pragma once
+
+#include "document.h"
+#include "inverted_index.h"
+#include "relevance_accumulator.h"
+#include "search_server.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Флаг отмены поиска; копии токена разделяют один флаг
+class CancellationToken {
+public:
+    CancellationToken();
+
+    void Cancel();
+    bool IsCancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Ограничения поиска: срок и токен отмены
+struct QueryBudget {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    CancellationToken token{};
+
+    bool IsExpired() const;
+};
+
+// Лучшие документы; is_partial означает, что поиск был прерван
+// и релевантность посчитана не по всем спискам документов
+struct TopDocuments {
+    std::vector<Document> documents;
+    bool is_partial = false;
+};
+
+// Поиск, который можно выполнять по частям. Обход списков документов -
+// корутина на основе того же подсчёта релевантности, что и в FindTopDocuments:
+// она приостанавливается, когда обойдено заданное число записей, и продолжается
+// следующим вызовом Resume. Слова обходятся в том же порядке, поэтому полностью
+// выполненный поиск находит те же документы с той же релевантностью.
+// Сервер не должен меняться, пока поиск не завершён
+class QueryEvaluation {
+public:
+    QueryEvaluation(const SearchServer& server, const std::string_view raw_query,
+                    DocumentStatus status = DocumentStatus::ACTUAL,
+                    size_t result_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    // Корутина обращается к полям объекта, поэтому он не перемещается
+    QueryEvaluation(const QueryEvaluation&) = delete;
+    QueryEvaluation& operator=(const QueryEvaluation&) = delete;
+    ~QueryEvaluation();
+
+    // Обходит не больше posting_count записей; возвращает true, когда обойдены все.
+    // posting_count == 0 отвергается исключением invalid_argument
+    bool Resume(size_t posting_count);
+    bool IsFinished() const;
+
+    // Лучшие документы по уже обойдённым записям. Вызывается один раз
+    TopDocuments GetTopDocuments();
+
+private:
+    // Корутина, которая стоит в начале до первого Resume
+    // и останавливается в конце, чтобы можно было узнать, что обход завершён
+    struct Traversal {
+        struct promise_type {
+            Traversal get_return_object();
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { throw; }
+        };
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    const SearchServer& server_;
+    DocumentStatus status_;
+    size_t result_count_;
+
+    std::vector<int> excluded_documents_{};
+    std::vector<const PostingList*> plus_postings_{};
+    std::vector<double> inverse_document_freqs_{};
+    SearchServer::DocumentIdRange range_{};
+    RelevanceAccumulator accumulator_{};
+    // Сколько записей ещё можно обойти до приостановки
+    size_t posting_budget_ = 0;
+    std::coroutine_handle<Traversal::promise_type> traversal_{};
+
+    Traversal Traverse();
+};
+
+// Планировщик с одним потоком, который по очереди продвигает поставленные
+// поиски на slice_size записей. Длинный запрос не задерживает короткие,
+// а поиск с истёкшим бюджетом завершается лучшими документами на этот момент
+class QueryScheduler {
+public:
+    static constexpr size_t DEFAULT_SLICE_SIZE = 4096;
+
+    // slice_size должен быть положительным
+    explicit QueryScheduler(size_t slice_size = DEFAULT_SLICE_SIZE);
+    ~QueryScheduler();
+
+    QueryScheduler(const QueryScheduler&) = delete;
+    QueryScheduler& operator=(const QueryScheduler&) = delete;
+
+    // Некорректный запрос отвергается сразу исключением
+    std::future<TopDocuments> Submit(const SearchServer& server, const std::string_view raw_query,
+                                     QueryBudget budget = {},
+                                     DocumentStatus status = DocumentStatus::ACTUAL,
+                                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT);
+
+private:
+    struct Task {
+        Task(const SearchServer& server, const std::string_view raw_query, QueryBudget budget,
+             DocumentStatus status, size_t result_count);
+
+        QueryEvaluation evaluation;
+        QueryBudget budget;
+        std::promise<TopDocuments> result{};
+    };
+
+    size_t slice_size_;
+    std::mutex mutex_{};
+    std::condition_variable task_added_{};
+    std::deque<std::unique_ptr<Task>> tasks_{};
+    bool stopping_ = false;
+    std::thread thread_{};
+
+    void Run();
+};
+
+// Выполняет поиск частями по posting_count записей, проверяя бюджет между ними.
+// Первая часть выполняется в любом случае; posting_count должен быть положительным
+TopDocuments FindTopDocumentsWithBudget(const SearchServer& server,
+                                        const std::string_view raw_query,
+                                        const QueryBudget& budget,
+                                        DocumentStatus status = DocumentStatus::ACTUAL,
+                                        size_t result_count = MAX_RESULT_DOCUMENT_COUNT,
+                                        size_t posting_count = QueryScheduler::DEFAULT_SLICE_SIZE);
@@ -0,0 +1,59 @@
+#include "relevance_accumulator.h"
+
+#include <algorithm>
+
+RelevanceAccumulator::RelevanceAccumulator(int first_document_id,
+                                           size_t width,
+                                           bool dense)
+{
+    Reset(first_document_id, width, dense);
+}
+
+void RelevanceAccumulator::Reset(int first_document_id, size_t width, bool dense)
+{
+    // Нулями заполняются только ячейки, задетые прошлым запросом
+    for (const uint32_t index : touched_indexes_) {
+        relevance_[index] = 0.0;
+        touched_[index] = 0;
+    }
+    touched_indexes_.clear();
+    hits_.clear();
+
+    first_document_id_ = first_document_id;
+    width_ = width;
+    dense_ = dense;
+    if (dense_ && relevance_.size() < width) {
+        relevance_.resize(width, 0.0);
+        touched_.resize(width, 0);
+    }
+}
+
+void RelevanceAccumulator::Add(int document_id, double relevance)
+{
+    if (dense_) {
+        const auto index = static_cast<size_t>(document_id - first_document_id_);
+        relevance_[index] += relevance;
+        if (!touched_[index]) {
+            touched_[index] = 1;
+            touched_indexes_.push_back(static_cast<uint32_t>(index));
+        }
+    } else {
+        hits_.push_back({document_id, static_cast<uint32_t>(hits_.size()), relevance});
+    }
+}
+
+void RelevanceAccumulator::SortHits()
+{
+    std::sort(hits_.begin(), hits_.end(),
+              [](const Hit& lhs, const Hit& rhs) {
+                  return lhs.document_id < rhs.document_id
+                          || (lhs.document_id == rhs.document_id && lhs.order < rhs.order);
+              });
+}
+
+bool RelevanceAccumulator::SortTouchedIndexes()
+{
+    if (touched_indexes_.size() * 16 > width_) return false;
+    std::sort(touched_indexes_.begin(), touched_indexes_.end());
+    return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Накопитель релевантности для диапазона id документов, начинающегося с first_document_id.
+// Если диапазон плотный (dense), релевантность суммируется в массиве, индексируемом id,
+// иначе попадания собираются в список и сворачиваются после сортировки.
+// Массив очищается и обходится только по задетым ячейкам, поэтому запрос
+// с редкими словами не платит за ширину диапазона.
+// Каждый поток работает со своим накопителем, поэтому блокировки не нужны.
+class RelevanceAccumulator {
+public:
+    RelevanceAccumulator() = default;
+    RelevanceAccumulator(int first_document_id, size_t width, bool dense);
+
+    // Очищает накопитель для нового диапазона, сохраняя выделенную память
+    void Reset(int first_document_id, size_t width, bool dense);
+
+    void Add(int document_id, double relevance);
+
+    // Вызывает callback(document_id, relevance) в порядке возрастания id.
+    // Вклады одного документа суммируются в порядке добавления.
+    template <typename Callback>
+    void ForEach(Callback callback);
+
+private:
+    // order - порядковый номер попадания, чтобы вклады суммировались
+    // в порядке добавления без устойчивой сортировки
+    struct Hit {
+        int document_id;
+        uint32_t order;
+        double relevance;
+    };
+
+    int first_document_id_ = 0;
+    size_t width_ = 0;
+    bool dense_ = false;
+    std::vector<double> relevance_{};
+    std::vector<char> touched_{};
+    std::vector<uint32_t> touched_indexes_{};
+    std::vector<Hit> hits_{};
+
+    void SortHits();
+    // Сортирует задетые ячейки, если их мало по сравнению с шириной диапазона;
+    // возвращает false, если выгоднее просмотреть весь массив
+    bool SortTouchedIndexes();
+};
+
+template <typename Callback>
+void RelevanceAccumulator::ForEach(Callback callback)
+{
+    if (dense_) {
+        if (SortTouchedIndexes()) {
+            for (const uint32_t i : touched_indexes_) {
+                callback(first_document_id_ + static_cast<int>(i), relevance_[i]);
+            }
+            return;
+        }
+        for (size_t i = 0; i < width_; ++i) {
+            if (touched_[i]) {
+                callback(first_document_id_ + static_cast<int>(i), relevance_[i]);
+            }
+        }
+        return;
+    }
+
+    SortHits();
+    for (size_t i = 0; i < hits_.size();) {
+        const int document_id = hits_[i].document_id;
+        double relevance = 0.0;
+        for (; i < hits_.size() && hits_[i].document_id == document_id; ++i) {
+            relevance += hits_[i].relevance;
+        }
+        callback(document_id, relevance);
+    }
+}
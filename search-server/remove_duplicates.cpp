@@ -1,30 +1,248 @@
 #include "remove_duplicates.h"
+#include "stop_words.h"
 
-#include <algorithm>
-#include <iterator>
+#include <limits>
+#include <tuple>
 
-void RemoveDuplicates(SearchServer& server)
+WordSetFingerprint ComputeWordSetFingerprint(int document_id,
+                                             const std::map<std::string_view, double>& word_freqs)
 {
-    std::set<int> docs_to_delete;
-    std::map<std::set<std::string_view>, int> words_to_doc;
+    // Суммы не зависят от порядка слов, а слова документа не повторяются
+    WordSetFingerprint fingerprint;
+    fingerprint.document_id = document_id;
+    fingerprint.word_count = word_freqs.size();
+    for (const auto& [word, freq] : word_freqs) {
+        const uint64_t hash = perfect_hash::Hash(word);
+        fingerprint.hash_sum += hash;
+        fingerprint.mixed_hash_sum += perfect_hash::Mix(hash ^ 0x9e3779b97f4a7c15ULL);
+    }
+    return fingerprint;
+}
+
+bool operator<(const WordSetFingerprint& lhs, const WordSetFingerprint& rhs)
+{
+    return std::tie(lhs.hash_sum, lhs.mixed_hash_sum, lhs.word_count, lhs.document_id)
+            < std::tie(rhs.hash_sum, rhs.mixed_hash_sum, rhs.word_count, rhs.document_id);
+}
+
+std::vector<int> RemoveDuplicates(SearchServer& search_server)
+{
+    return RemoveDuplicates(std::execution::seq, search_server);
+}
+
+namespace {
+
+bool HaveSameWords(const std::map<std::string_view, double>& lhs,
+                   const std::map<std::string_view, double>& rhs)
+{
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                      [](const auto& l, const auto& r) { return l.first == r.first; });
+}
+
+bool HaveSameFingerprint(const WordSetFingerprint& lhs, const WordSetFingerprint& rhs)
+{
+    return lhs.hash_sum == rhs.hash_sum
+            && lhs.mixed_hash_sum == rhs.mixed_hash_sum
+            && lhs.word_count == rhs.word_count;
+}
+
+} // namespace
+
+std::vector<int> FindDuplicates(const SearchServer& search_server,
+                                const std::vector<WordSetFingerprint>& fingerprints)
+{
+    std::vector<int> duplicates;
+    // Документы с равными отпечатками, у которых наборы слов различны
+    std::vector<int> originals;
+    for (auto first = fingerprints.begin(); first != fingerprints.end(); ) {
+        const auto last = std::find_if_not(first, fingerprints.end(),
+                                           [first](const WordSetFingerprint& fingerprint) {
+            return HaveSameFingerprint(fingerprint, *first);
+        });
+
+        originals.clear();
+        for (auto it = first; it != last; ++it) {
+            const auto& word_freqs = search_server.GetWordFrequencies(it->document_id);
+            const bool is_duplicate = std::any_of(originals.begin(), originals.end(),
+                                                  [&](int original_id) {
+                return HaveSameWords(word_freqs, search_server.GetWordFrequencies(original_id));
+            });
+            if (is_duplicate) {
+                duplicates.push_back(it->document_id);
+            } else {
+                originals.push_back(it->document_id);
+            }
+        }
+        first = last;
+    }
+
+    std::sort(duplicates.begin(), duplicates.end());
+    return duplicates;
+}
+
+std::vector<int> SelectNearDuplicates(const SearchServer& search_server,
+                                      const std::vector<std::vector<int>>& clusters,
+                                      double similarity_threshold)
+{
+    std::vector<int> near_duplicates;
+    std::vector<int> kept;
+    for (const auto& cluster : clusters) {
+        kept.clear();
+        for (const int document_id : cluster) {
+            const auto& word_freqs = search_server.GetWordFrequencies(document_id);
+            const bool is_near_duplicate = std::any_of(kept.begin(), kept.end(),
+                                                       [&](int kept_id) {
+                return ComputeJaccardSimilarity(word_freqs, search_server.GetWordFrequencies(kept_id))
+                        >= similarity_threshold;
+            });
+            if (is_near_duplicate) {
+                near_duplicates.push_back(document_id);
+            } else {
+                kept.push_back(document_id);
+            }
+        }
+    }
+    std::sort(near_duplicates.begin(), near_duplicates.end());
+    return near_duplicates;
+}
+
+std::vector<std::vector<int>> FindNearDuplicates(const SearchServer& search_server,
+                                                 const NearDuplicateOptions& options)
+{
+    return FindNearDuplicates(std::execution::seq, search_server, options);
+}
+
+std::vector<int> RemoveNearDuplicates(SearchServer& search_server,
+                                      const NearDuplicateOptions& options)
+{
+    return RemoveNearDuplicates(std::execution::seq, search_server, options);
+}
 
-    for (int document_id : server) {
-        const auto& words = server.GetWordFrequencies(document_id);
-        std::set<std::string_view> words_key;
-        std::transform(words.begin(),
-                       words.end(),
-                       std::inserter(words_key, words_key.end()),
-                       [](auto pair){ return pair.first; }
-        );
-        if (0 == words_to_doc.count(words_key)) {
-            words_to_doc[words_key] = document_id;
+void ComputeMinHashSignature(const std::map<std::string_view, double>& word_freqs,
+                             uint64_t* signature, size_t signature_length)
+{
+    // Вместо signature_length независимых хеш-функций - семейство h1 + i * h2,
+    // перемешанное одним умножением
+    std::fill(signature, signature + signature_length, std::numeric_limits<uint64_t>::max());
+    for (const auto& [word, freq] : word_freqs) {
+        const uint64_t hash = perfect_hash::Hash(word);
+        const uint64_t step = perfect_hash::Mix(hash ^ 0x9e3779b97f4a7c15ULL) | 1;
+        uint64_t value = hash;
+        for (size_t i = 0; i < signature_length; ++i) {
+            const uint64_t row_hash = (value ^ (value >> 31)) * 0x94d049bb133111ebULL;
+            signature[i] = std::min(signature[i], row_hash);
+            value += step;
+        }
+    }
+}
+
+double ComputeJaccardSimilarity(const std::map<std::string_view, double>& lhs,
+                                const std::map<std::string_view, double>& rhs)
+{
+    size_t common_count = 0;
+    auto l = lhs.begin();
+    auto r = rhs.begin();
+    while (l != lhs.end() && r != rhs.end()) {
+        if (l->first < r->first) {
+            ++l;
+        } else if (r->first < l->first) {
+            ++r;
         } else {
-            docs_to_delete.emplace(document_id);
+            ++common_count;
+            ++l;
+            ++r;
         }
     }
+    const size_t union_count = lhs.size() + rhs.size() - common_count;
+    return union_count == 0 ? 1.0 : static_cast<double>(common_count) / static_cast<double>(union_count);
+}
 
-    for (int id : docs_to_delete) {
-        std::cout << "Found duplicate document id " << id << '\n';
-        server.RemoveDocument(id);
+uint64_t ComputeBandHash(const uint64_t* rows, size_t rows_per_band)
+{
+    uint64_t hash = 0;
+    for (size_t row = 0; row < rows_per_band; ++row) {
+        hash = perfect_hash::Mix(hash ^ rows[row]);
+    }
+    return hash;
+}
+
+std::vector<std::pair<size_t, size_t>>
+FindSimilarPairsInBand(const WordFreqsList& word_freqs, const uint64_t* band_hashes,
+                       double similarity_threshold)
+{
+    std::vector<std::pair<uint64_t, size_t>> hashes(word_freqs.size());
+    for (size_t index = 0; index < word_freqs.size(); ++index) {
+        hashes[index] = {band_hashes[index], index};
+    }
+    std::sort(hashes.begin(), hashes.end());
+
+    // Документ группы сравнивается со всеми представителями - документами,
+    // не похожими ни на одного предыдущего представителя. Похожий на
+    // представителя документ связывается с ним, остальные становятся
+    // представителями, так что случайное совпадение хеша у первого
+    // документа группы не скрывает пары среди остальных
+    std::vector<std::pair<size_t, size_t>> similar_pairs;
+    std::vector<size_t> representatives;
+    for (auto first = hashes.begin(); first != hashes.end(); ) {
+        const auto last = std::find_if(first, hashes.end(), [first](const auto& hash) {
+            return hash.first != first->first;
+        });
+        representatives.assign(1, first->second);
+        for (auto it = first + 1; it != last; ++it) {
+            bool is_similar = false;
+            for (const size_t representative : representatives) {
+                if (ComputeJaccardSimilarity(*word_freqs[representative], *word_freqs[it->second])
+                        >= similarity_threshold) {
+                    similar_pairs.emplace_back(representative, it->second);
+                    is_similar = true;
+                }
+            }
+            if (!is_similar) {
+                representatives.push_back(it->second);
+            }
+        }
+        first = last;
+    }
+    return similar_pairs;
+}
+
+std::vector<std::vector<int>>
+BuildNearDuplicateClusters(const std::vector<int>& document_ids,
+                           const std::vector<std::vector<std::pair<size_t, size_t>>>& similar_pairs)
+{
+    // Система непересекающихся множеств; корень - документ с меньшим индексом,
+    // то есть с меньшим id
+    std::vector<size_t> parents(document_ids.size());
+    std::iota(parents.begin(), parents.end(), 0);
+    const auto find_root = [&parents](size_t index) {
+        while (parents[index] != index) {
+            parents[index] = parents[parents[index]];
+            index = parents[index];
+        }
+        return index;
+    };
+    for (const auto& band_pairs : similar_pairs) {
+        for (const auto& [lhs, rhs] : band_pairs) {
+            const size_t lhs_root = find_root(lhs);
+            const size_t rhs_root = find_root(rhs);
+            if (lhs_root != rhs_root) {
+                parents[std::max(lhs_root, rhs_root)] = std::min(lhs_root, rhs_root);
+            }
+        }
+    }
+
+    // Индексы идут по возрастанию id, поэтому id в кластерах упорядочены
+    std::vector<std::vector<int>> clusters;
+    std::vector<size_t> cluster_indexes(document_ids.size(), document_ids.size());
+    for (size_t index = 0; index < document_ids.size(); ++index) {
+        const size_t root = find_root(index);
+        if (root == index) continue;
+        if (cluster_indexes[root] == document_ids.size()) {
+            cluster_indexes[root] = clusters.size();
+            clusters.push_back({document_ids[root]});
+        }
+        clusters[cluster_indexes[root]].push_back(document_ids[index]);
     }
+    std::sort(clusters.begin(), clusters.end());
+    return clusters;
 }
@@ -1,5 +1,194 @@
 #pragma once
 
 #include "search_server.h"
+#include "thread_pool.h"
 
-void RemoveDuplicates(SearchServer& search_server);
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Отпечаток набора слов документа. Не зависит от порядка и частот слов,
+// поэтому у документов с одинаковыми наборами слов отпечатки совпадают;
+// совпадение отпечатков у разных наборов возможно, но маловероятно.
+struct WordSetFingerprint {
+    uint64_t hash_sum = 0;
+    uint64_t mixed_hash_sum = 0;
+    size_t word_count = 0;
+    int document_id = 0;
+};
+
+WordSetFingerprint ComputeWordSetFingerprint(int document_id,
+                                             const std::map<std::string_view, double>& word_freqs);
+
+// Документы с одинаковым отпечатком идут подряд по возрастанию id
+bool operator<(const WordSetFingerprint& lhs, const WordSetFingerprint& rhs);
+
+// Удаляет документы с тем же набором слов, что у документа с меньшим id.
+// Отпечатки документов вычисляются и сортируются с заданной политикой,
+// наборы слов сравниваются только у документов с равными отпечатками.
+// Дубликаты удаляются одной пачкой. Возвращает id удалённых документов по возрастанию.
+template <typename ExecutionPolicy>
+std::vector<int> RemoveDuplicates(ExecutionPolicy&& policy, SearchServer& search_server);
+
+std::vector<int> RemoveDuplicates(SearchServer& search_server);
+
+// id дубликатов среди документов с отсортированными отпечатками
+std::vector<int> FindDuplicates(const SearchServer& search_server,
+                                const std::vector<WordSetFingerprint>& fingerprints);
+
+template <typename ExecutionPolicy>
+std::vector<int> RemoveDuplicates(ExecutionPolicy&& policy, SearchServer& search_server)
+{
+    const SearchServer& server = search_server;
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    std::vector<WordSetFingerprint> fingerprints(document_ids.size());
+    ForEach(policy, document_ids.begin(), document_ids.end(),
+            [&server, &document_ids, &fingerprints](const int& document_id) {
+        fingerprints[static_cast<size_t>(&document_id - document_ids.data())] =
+                ComputeWordSetFingerprint(document_id, server.GetWordFrequencies(document_id));
+    });
+    Sort(policy, fingerprints.begin(), fingerprints.end(), std::less<>{});
+
+    const std::vector<int> duplicates = FindDuplicates(server, fingerprints);
+    search_server.RemoveDocuments(policy, duplicates);
+    return duplicates;
+}
+
+// Параметры поиска почти-дубликатов. Сигнатура MinHash документа состоит
+// из band_count * rows_per_band минимальных хешей его слов и делится на полосы.
+// Документы, у которых совпала хотя бы одна полоса, становятся кандидатами,
+// и для них считается точный коэффициент Жаккара наборов слов.
+// Пара с похожестью s совпадает хотя бы в одной полосе с вероятностью
+// 1 - (1 - s^rows_per_band)^band_count; при значениях по умолчанию это
+// 0.9996 для s = 0.8 и 0.47 для s = 0.5. Внутри группы с одинаковой полосой
+// документ сравнивается с её представителями (см. FindSimilarPairsInBand),
+// поэтому пара, у которой один документ уже связан с похожим на него
+// представителем, проверяется не напрямую, и доля найденных пар
+// может быть немного ниже этой оценки.
+struct NearDuplicateOptions {
+    double similarity_threshold = 0.8;
+    size_t band_count = 20;
+    size_t rows_per_band = 5;
+};
+
+// Кластеры почти-дубликатов: документы, связанные цепочкой пар с
+// коэффициентом Жаккара наборов слов не ниже порога. Из-за цепочек
+// похожесть двух документов одного кластера может быть ниже порога.
+// id в кластере по возрастанию, кластеры упорядочены по первому id.
+// Время работы почти линейно по числу документов: точно сравниваются
+// только кандидаты, причём в группе документов с одинаковой полосой -
+// только с её представителями.
+template <typename ExecutionPolicy>
+std::vector<std::vector<int>> FindNearDuplicates(ExecutionPolicy&& policy,
+                                                 const SearchServer& search_server,
+                                                 const NearDuplicateOptions& options = {});
+
+std::vector<std::vector<int>> FindNearDuplicates(const SearchServer& search_server,
+                                                 const NearDuplicateOptions& options = {});
+
+// Удаляет документы, похожие не меньше порога на оставленный документ
+// своего кластера. Документы кластера перебираются по возрастанию id,
+// и непохожий ни на один оставленный остаётся сам, поэтому
+// по цепочке документ не удаляется.
+// Возвращает id удалённых документов по возрастанию.
+template <typename ExecutionPolicy>
+std::vector<int> RemoveNearDuplicates(ExecutionPolicy&& policy, SearchServer& search_server,
+                                      const NearDuplicateOptions& options = {});
+
+std::vector<int> RemoveNearDuplicates(SearchServer& search_server,
+                                      const NearDuplicateOptions& options = {});
+
+// Записывает в signature signature_length минимальных хешей слов документа
+void ComputeMinHashSignature(const std::map<std::string_view, double>& word_freqs,
+                             uint64_t* signature, size_t signature_length);
+
+// Хеш строк сигнатуры, составляющих одну полосу
+uint64_t ComputeBandHash(const uint64_t* rows, size_t rows_per_band);
+
+double ComputeJaccardSimilarity(const std::map<std::string_view, double>& lhs,
+                                const std::map<std::string_view, double>& rhs);
+
+using WordFreqsList = std::vector<const std::map<std::string_view, double>*>;
+
+// Пары индексов документов с одинаковым хешем полосы и похожестью не ниже порога.
+// Каждый документ группы сравнивается со всеми её представителями
+std::vector<std::pair<size_t, size_t>>
+FindSimilarPairsInBand(const WordFreqsList& word_freqs, const uint64_t* band_hashes,
+                       double similarity_threshold);
+
+// Документы кластеров, удаляемые RemoveNearDuplicates, по возрастанию id
+std::vector<int> SelectNearDuplicates(const SearchServer& search_server,
+                                      const std::vector<std::vector<int>>& clusters,
+                                      double similarity_threshold);
+
+std::vector<std::vector<int>>
+BuildNearDuplicateClusters(const std::vector<int>& document_ids,
+                           const std::vector<std::vector<std::pair<size_t, size_t>>>& similar_pairs);
+
+template <typename ExecutionPolicy>
+std::vector<std::vector<int>> FindNearDuplicates(ExecutionPolicy&& policy,
+                                                 const SearchServer& search_server,
+                                                 const NearDuplicateOptions& options)
+{
+    if (options.band_count == 0 || options.rows_per_band == 0) {
+        throw std::invalid_argument("Сигнатура MinHash не может быть пустой");
+    }
+
+    // Документы без слов ни на что не похожи
+    std::vector<int> document_ids;
+    WordFreqsList word_freqs;
+    for (const int document_id : search_server) {
+        const auto& document_word_freqs = search_server.GetWordFrequencies(document_id);
+        if (!document_word_freqs.empty()) {
+            document_ids.push_back(document_id);
+            word_freqs.push_back(&document_word_freqs);
+        }
+    }
+
+    // Сигнатура сразу сворачивается в хеши полос, которые хранятся по полосам:
+    // так они в несколько раз меньше сигнатур и читаются подряд
+    const size_t document_count = document_ids.size();
+    const size_t signature_length = options.band_count * options.rows_per_band;
+    std::vector<uint64_t> band_hashes(document_count * options.band_count);
+    std::vector<size_t> indexes(document_count);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    ForEach(policy, indexes.begin(), indexes.end(), [&](size_t index) {
+        thread_local std::vector<uint64_t> signature;
+        signature.resize(signature_length);
+        ComputeMinHashSignature(*word_freqs[index], signature.data(), signature_length);
+        for (size_t band = 0; band < options.band_count; ++band) {
+            band_hashes[band * document_count + index] =
+                    ComputeBandHash(signature.data() + band * options.rows_per_band,
+                                    options.rows_per_band);
+        }
+    });
+
+    std::vector<size_t> bands(options.band_count);
+    std::iota(bands.begin(), bands.end(), 0);
+    std::vector<std::vector<std::pair<size_t, size_t>>> similar_pairs(options.band_count);
+    ForEach(policy, bands.begin(), bands.end(), [&](size_t band) {
+        similar_pairs[band] = FindSimilarPairsInBand(word_freqs,
+                                                     band_hashes.data() + band * document_count,
+                                                     options.similarity_threshold);
+    });
+
+    return BuildNearDuplicateClusters(document_ids, similar_pairs);
+}
+
+template <typename ExecutionPolicy>
+std::vector<int> RemoveNearDuplicates(ExecutionPolicy&& policy, SearchServer& search_server,
+                                      const NearDuplicateOptions& options)
+{
+    const std::vector<int> near_duplicates =
+            SelectNearDuplicates(search_server, FindNearDuplicates(policy, search_server, options),
+                                 options.similarity_threshold);
+    search_server.RemoveDocuments(policy, near_duplicates);
+    return near_duplicates;
+}
@@ -5,7 +5,8 @@
 #include <vector>
 
 RequestQueue::RequestQueue(const SearchServer& search_server)
-        : server_(search_server)
+        : server_(search_server),
+          cache_(search_server)
 {
 
 }
@@ -13,14 +14,14 @@ RequestQueue::RequestQueue(const SearchServer& search_server)
 std::vector<Document>
 RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status)
 {
-    AddQueryResult({raw_query, server_.FindTopDocuments(raw_query, status)});
+    AddQueryResult({raw_query, cache_.FindTopDocuments(raw_query, status)});
     return requests_.back().result;
 }
 
 std::vector<Document>
 RequestQueue::AddFindRequest(const std::string& raw_query)
 {
-    AddQueryResult({raw_query, server_.FindTopDocuments(raw_query)});
+    AddQueryResult({raw_query, cache_.FindTopDocuments(raw_query)});
     return requests_.back().result;
 }
 
@@ -29,6 +30,11 @@ int RequestQueue::GetNoResultRequests() const
     return bad_requests_count;
 }
 
+const QueryCache& RequestQueue::GetCache() const
+{
+    return cache_;
+}
+
 void RequestQueue::AddQueryResult(const RequestQueue::QueryResult& qr)
 {
     requests_.emplace_back(qr);
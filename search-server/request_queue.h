@@ -1,6 +1,7 @@
 #pragma once
 
 #include "document.h"
+#include "query_cache.h"
 #include "search_server.h"
 
 #include <string>
@@ -17,6 +18,8 @@ public:
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
     int GetNoResultRequests() const;
+    // Запросы по статусу повторяются часто, их результаты берутся из кэша
+    const QueryCache& GetCache() const;
 
 private:
     struct QueryResult {
@@ -27,6 +30,7 @@ private:
     void AddQueryResult(const QueryResult& qr);
 
     const SearchServer& server_;
+    QueryCache cache_;
     std::deque<QueryResult> requests_;
     const static int min_in_day_ = 1440;
     int bad_requests_count{};
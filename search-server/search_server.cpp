@@ -1,16 +1,19 @@
 #include "search_server.h"
+#include "index_snapshot.h"
 #include "string_processing.h"
 
 #include <algorithm>
+#include <atomic>
 #include <numeric>
 #include <cmath>
+#include <thread>
 
-SearchServer::SearchServer(const std::string& stop_words)
-    : SearchServer {SplitIntoWords(stop_words)}
+SearchServer::SearchServer(const std::string& stop_words, PostingFormat posting_format)
+    : SearchServer {SplitIntoWords(stop_words), posting_format}
 {
 }
-SearchServer::SearchServer(const std::string_view stop_words)
-    : SearchServer {SplitIntoWords(stop_words)}
+SearchServer::SearchServer(const std::string_view stop_words, PostingFormat posting_format)
+    : SearchServer {SplitIntoWords(stop_words), posting_format}
 {
 }
 
@@ -19,53 +22,202 @@ void SearchServer::AddDocument(int document_id,
                                DocumentStatus status,
                                const std::vector<int>& ratings)
 {
-    if (document_id < 0) {
-        throw std::invalid_argument("Документ с отрицательным id");
-    }
-    if (!IsValidString(document)) {
-        throw std::invalid_argument("В тексте документа недопустимые символы");
+    WordFreqs word_freqs;
+    const bool is_valid_text = ComputeWordFreqs(document, word_freqs);
+    CheckNewDocument(document_id, is_valid_text);
+
+    const DocumentData& data = RegisterDocument(document_id, document, status,
+                                                ratings, word_freqs);
+    for (size_t i = 0; i < data.terms.size(); ++i) {
+        index_.Add(data.terms[i], document_id, word_freqs[i].second);
     }
+    index_.SetDocumentCount(documents_.size());
+    epoch_.Advance();
+}
 
-    auto id_emplaced = documents_id_.emplace(document_id);
-    if (!id_emplaced.second) {
-        throw std::invalid_argument("Документ с id уже добавлен");
-    }
+std::vector<Document>
+SearchServer::FindTopDocuments(const std::string_view raw_query,
+                               DocumentStatus status,
+                               size_t result_count) const
+{
+    return FindTopDocuments(std::execution::seq, raw_query, status, result_count);
+}
+
+const std::vector<Document>&
+SearchServer::FindTopDocuments(QueryContext& context,
+                               const std::string_view raw_query,
+                               DocumentStatus status,
+                               size_t result_count) const
+{
+    const auto predicate = [status]([[maybe_unused]] int document_id,
+                                    DocumentStatus s,
+                                    [[maybe_unused]] int rating)
+                                    {
+                                        return s == status;
+                                    };
+    return FindTopDocuments(context, raw_query, predicate, result_count);
+}
 
-    auto doc_emplaced = documents_.emplace(document_id, DocumentData
-                                          {ComputeAverageRating(ratings),
-                                           status,
-                                           std::string{document}}
-                                          );
+std::vector<Document>
+SearchServer::FindTopDocumentsWithPruning(const std::string_view raw_query,
+                                          DocumentStatus status,
+                                          size_t result_count) const
+{
+    const auto predicate = [status]([[maybe_unused]] int document_id,
+                                    DocumentStatus s,
+                                    [[maybe_unused]] int rating)
+                                    {
+                                        return s == status;
+                                    };
+    return FindTopDocumentsWithPruning(raw_query, predicate, result_count);
+}
 
-    const std::vector<std::string_view> words {
-        SplitIntoWordsNoStop(doc_emplaced.first->second.content)
+int SearchServer::GetDocumentCount() const
+{
+    return static_cast<int>(documents_.size());
+}
+
+std::future<std::vector<Document>>
+SearchServer::FindTopDocumentsAsync(ThreadPool& pool,
+                                    const std::string_view raw_query,
+                                    DocumentStatus status,
+                                    size_t result_count) const
+{
+    const auto predicate = [status]([[maybe_unused]] int document_id,
+                                    DocumentStatus s,
+                                    [[maybe_unused]] int rating)
+                                    {
+                                        return s == status;
+                                    };
+    return FindTopDocumentsAsync(pool, raw_query, predicate, result_count);
+}
+
+std::vector<std::vector<Document>>
+SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                    DocumentStatus status,
+                                    size_t result_count) const
+{
+    return FindTopDocumentsBatch(std::execution::seq, raw_queries, status, result_count);
+}
+
+size_t SearchServer::GetBatchChunkBegin(size_t chunk, size_t chunk_count, size_t query_count)
+{
+    return query_count * chunk / chunk_count;
+}
+
+void SearchServer::FindTopDocumentsBatch(const std::vector<Query>& queries,
+                                         size_t first, size_t last,
+                                         DocumentStatus status, size_t result_count,
+                                         std::vector<Document>& documents,
+                                         std::vector<size_t>& counts) const
+{
+    struct TermUse {
+        TermId term;
+        uint32_t query;
+        bool is_minus;
     };
+    std::vector<TermUse> uses;
+    for (size_t query = first; query < last; ++query) {
+        const auto index = static_cast<uint32_t>(query - first);
+        for (const TermId term : queries[query].plus_terms) {
+            uses.push_back({term, index, false});
+        }
+        for (const TermId term : queries[query].minus_terms) {
+            uses.push_back({term, index, true});
+        }
+    }
+    // Слова обходятся по возрастанию номеров, как и в FindTopDocuments,
+    // поэтому вклады слов в релевантность складываются в том же порядке
+    std::sort(uses.begin(), uses.end(), [](const TermUse& lhs, const TermUse& rhs) {
+        return lhs.term < rhs.term || (lhs.term == rhs.term && lhs.query < rhs.query);
+    });
 
-    const double inv_word_count = 1.0 / static_cast<double>(words.size());
+    std::vector<RelevanceAccumulator> accumulators(last - first);
+    for (RelevanceAccumulator& accumulator : accumulators) {
+        accumulator.Reset(0, 0, false);
+    }
+    std::vector<std::vector<int>> excluded_documents(last - first);
+    std::vector<uint32_t> plus_queries;
+    std::vector<uint32_t> minus_queries;
+    for (auto use = uses.begin(); use != uses.end(); ) {
+        const TermId term = use->term;
+        plus_queries.clear();
+        minus_queries.clear();
+        for (; use != uses.end() && use->term == term; ++use) {
+            (use->is_minus ? minus_queries : plus_queries).push_back(use->query);
+        }
+        const PostingList* postings = index_.Find(term);
+        if (postings == nullptr) continue;
+
+        const double inverse_document_freq = index_.GetInverseDocumentFreq(*postings);
+        for (PostingList::Cursor cursor = postings->GetCursor(); !cursor.AtEnd(); cursor.Next()) {
+            const int document_id = cursor.DocumentId();
+            for (const uint32_t query : minus_queries) {
+                excluded_documents[query].push_back(document_id);
+            }
+            if (plus_queries.empty() || documents_.at(document_id).status != status) continue;
 
-    for (const std::string_view word : words) {
-        double freq = word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] = freq;
+            const double relevance = cursor.TermFreq() * inverse_document_freq;
+            for (const uint32_t query : plus_queries) {
+                accumulators[query].Add(document_id, relevance);
+            }
+        }
+    }
+
+    std::vector<Document> matched;
+    std::vector<Document> candidates;
+    for (size_t query = first; query < last; ++query) {
+        std::vector<int>& excluded = excluded_documents[query - first];
+        std::sort(excluded.begin(), excluded.end());
+        matched.clear();
+        auto excluded_it = excluded.begin();
+        accumulators[query - first].ForEach([&](int document_id, double relevance) {
+            excluded_it = std::lower_bound(excluded_it, excluded.end(), document_id);
+            if (excluded_it != excluded.end() && *excluded_it == document_id) return;
+            matched.emplace_back(document_id, relevance, documents_.at(document_id).rating);
+        });
+        SelectTopDocuments(std::execution::seq, matched, candidates, result_count);
+        documents.insert(documents.end(), matched.begin(), matched.end());
+        counts[query] = matched.size();
     }
 }
 
-std::vector<Document>
-SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const
+uint64_t SearchServer::GetEpoch() const
 {
-    return FindTopDocuments(std::execution::seq, raw_query, status);
+    return epoch_.value;
 }
 
-int SearchServer::GetDocumentCount() const
+uint64_t SearchServer::Epoch::Next()
 {
-    return static_cast<int>(documents_.size());
+    static std::atomic<uint64_t> counter {0};
+    return counter.fetch_add(1, std::memory_order_relaxed);
 }
 
-std::set<int>::const_iterator SearchServer::begin()
+std::string SearchServer::GetQueryKey(const std::string_view raw_query) const
+{
+    const Query query = ParseQuery(raw_query);
+    std::string key;
+    key.reserve((query.plus_terms.size() + query.minus_terms.size() + 1) * sizeof(TermId));
+    const auto append = [&key](TermId value) {
+        key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    // Число плюс-слов отделяет их от минус-слов
+    append(static_cast<TermId>(query.plus_terms.size()));
+    for (const TermId term : query.plus_terms) {
+        append(term);
+    }
+    for (const TermId term : query.minus_terms) {
+        append(term);
+    }
+    return key;
+}
+
+std::set<int>::const_iterator SearchServer::begin() const
 {
     return documents_id_.cbegin();
 }
 
-std::set<int>::const_iterator SearchServer::end()
+std::set<int>::const_iterator SearchServer::end() const
 {
     return documents_id_.cend();
 }
@@ -83,23 +235,18 @@ SearchServer::MatchDocument(const std::string_view raw_query, int document_id) c
     const Query query = ParseQuery(raw_query);
     std::vector<std::string_view> matched_words;
 
-    for (const std::string_view word : query.minus_words) {
-        if (0 == word_to_document_freqs_.count(word)) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
+    for (const TermId term : query.minus_terms) {
+        if (index_.Contains(term, document_id)) {
             return {matched_words, documents_.at(document_id).status};
         }
     }
 
-    for (const std::string_view word : query.plus_words) {
-        if (0 == word_to_document_freqs_.count(word)) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.emplace_back(word);
+    for (const TermId term : query.plus_terms) {
+        if (index_.Contains(term, document_id)) {
+            matched_words.emplace_back(index_.GetTerm(term));
         }
     }
+    std::sort(matched_words.begin(), matched_words.end());
 
     return {matched_words, documents_.at(document_id).status};
 }
@@ -119,44 +266,58 @@ SearchServer::MatchDocument(const std::execution::parallel_policy&,
 {
     if (documents_id_.count(document_id) == 0) throw std::out_of_range("No document");
 
-    const Query query {ParseQuery(raw_query, false)};
-    std::vector<std::string_view> matched_words;
+    const Query query {ParseQuery(raw_query)};
+    std::vector<TermId> matched_terms;
 
-    auto predicate = [this, &document_id](const std::string_view word) {
-        return word_to_document_freqs_.at(word).count(document_id);
+    auto predicate = [this, &document_id](const TermId term) {
+        return index_.Contains(term, document_id);
     };
 
     if (std::any_of(std::execution::par,
-                    query.minus_words.begin(),
-                    query.minus_words.end(),
+                    query.minus_terms.begin(),
+                    query.minus_terms.end(),
                     predicate))
     {
-        return {matched_words, documents_.at(document_id).status};
+        return {std::vector<std::string_view>{}, documents_.at(document_id).status};
     }
 
-    matched_words.resize(query.plus_words.size());
+    matched_terms.resize(query.plus_terms.size());
     auto it = std::copy_if(std::execution::par,
-                           query.plus_words.begin(),
-                           query.plus_words.end(),
-                           matched_words.begin(),
+                           query.plus_terms.begin(),
+                           query.plus_terms.end(),
+                           matched_terms.begin(),
                            predicate);
-
-    matched_words.resize(static_cast<size_t>(std::distance(matched_words.begin(), it)));
+    matched_terms.erase(it, matched_terms.end());
+
+    std::vector<std::string_view> matched_words(matched_terms.size());
+    std::transform(std::execution::par,
+                   matched_terms.begin(),
+                   matched_terms.end(),
+                   matched_words.begin(),
+                   [this](const TermId term) { return index_.GetTerm(term); });
     std::sort(std::execution::par, matched_words.begin(), matched_words.end());
-    auto last = std::unique(std::execution::par, matched_words.begin(), matched_words.end());
-    matched_words.erase(last, matched_words.end());
 
     return {matched_words, documents_.at(document_id).status};
 }
 
 void SearchServer::RemoveDocument(int document_id)
 {
-    for(const auto& [word, _]: document_to_word_freqs_.at(document_id)) {
-        word_to_document_freqs_.at(word).erase(document_id);
-    }
-    document_to_word_freqs_.erase(document_id);
-    documents_.erase(document_id);
-    documents_id_.erase(document_id);
+    RemoveDocuments(std::execution::seq, std::vector<int>{document_id});
+}
+
+void SearchServer::RemoveDocuments(std::vector<int> document_ids)
+{
+    RemoveDocuments(std::execution::seq, std::move(document_ids));
+}
+
+void SearchServer::SaveSnapshot(const std::string& path) const
+{
+    IndexSnapshot::Save(*this, path);
+}
+
+size_t SearchServer::GetPostingsMemoryUsage() const
+{
+    return index_.GetPostingsMemoryUsage();
 }
 
 bool SearchServer::IsValidString(const std::string_view word)
@@ -168,28 +329,125 @@ bool SearchServer::IsValidString(const std::string_view word)
 
 bool SearchServer::IsStopWord(const std::string_view word) const
 {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
 }
 
-std::vector<std::string_view>
-SearchServer::SplitIntoWordsNoStop(const std::string_view text) const
+int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
 {
-    std::vector<std::string_view> words;
-    for (const std::string_view wv : SplitIntoWords(text)) {
-        if (!IsStopWord(wv)) {
-            words.emplace_back(wv);
+    if(ratings.empty()) return 0;
+    return std::accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size());
+}
+
+bool SearchServer::ComputeWordFreqs(const std::string_view text, WordFreqs& word_freqs) const
+{
+    // Буфер слов переиспользуется между документами одного потока
+    thread_local std::vector<std::string_view> words;
+    words.clear();
+    if (!SplitIntoValidWords(text, words)) return false;
+
+    words.erase(std::remove_if(words.begin(), words.end(),
+                               [this](const std::string_view word) {
+                                   return IsStopWord(word);
+                               }),
+                words.end());
+    std::sort(words.begin(), words.end());
+
+    const double inv_word_count = 1.0 / static_cast<double>(words.size());
+    word_freqs.clear();
+    for (size_t i = 0; i < words.size();) {
+        const std::string_view word = words[i];
+        double freq = 0.0;
+        for (; i < words.size() && words[i] == word; ++i) {
+            freq += inv_word_count;
         }
+        word_freqs.emplace_back(word, freq);
     }
-    return words;
+    return true;
 }
 
-int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
+void SearchServer::CheckNewDocument(int document_id, bool is_valid_text) const
 {
-    if(ratings.empty()) return 0;
-    return std::accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size());
+    if (document_id < 0) {
+        throw std::invalid_argument("Документ с отрицательным id");
+    }
+    if (!is_valid_text) {
+        throw std::invalid_argument("В тексте документа недопустимые символы");
+    }
+    if (documents_id_.count(document_id) > 0) {
+        throw std::invalid_argument("Документ с id уже добавлен");
+    }
+}
+
+void SearchServer::CheckNewDocuments(const std::vector<const RawDocument*>& documents,
+                                     const std::vector<char>& valid_texts) const
+{
+    std::vector<int> ids;
+    ids.reserve(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        CheckNewDocument(documents[i]->id, valid_texts[i]);
+        ids.push_back(documents[i]->id);
+    }
+    std::sort(ids.begin(), ids.end());
+    if (std::adjacent_find(ids.begin(), ids.end()) != ids.end()) {
+        throw std::invalid_argument("Документ с id уже добавлен");
+    }
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view w) const
+SearchServer::DocumentData&
+SearchServer::RegisterDocument(int document_id, const std::string_view document,
+                               DocumentStatus status, const std::vector<int>& ratings,
+                               const WordFreqs& word_freqs)
+{
+    documents_id_.emplace(document_id);
+    DocumentData& data = documents_.emplace(document_id, DocumentData
+                                            {ComputeAverageRating(ratings),
+                                             status,
+                                             document_texts_.Store(document),
+                                             {}}
+                                            ).first->second;
+
+    auto& document_freqs = document_to_word_freqs_[document_id];
+    data.terms.reserve(word_freqs.size());
+    for (const auto& [word, freq] : word_freqs) {
+        const TermId term = index_.AddTerm(word);
+        data.terms.push_back(term);
+        document_freqs.emplace(index_.GetTerm(term), freq);
+    }
+    return data;
+}
+
+void SearchServer::ReleaseDocumentText(size_t text_size)
+{
+    removed_text_size_ += text_size;
+    // Тексты перекладываются в новое хранилище, когда больше половины
+    // занятой памяти приходится на удалённые документы
+    if (removed_text_size_ < TextArena::DEFAULT_CHUNK_SIZE
+            || 2 * removed_text_size_ < document_texts_.GetStoredSize()) {
+        return;
+    }
+
+    TextArena texts;
+    for (auto& [document_id, document] : documents_) {
+        document.content = texts.Store(document.content);
+    }
+    document_texts_ = std::move(texts);
+    removed_text_size_ = 0;
+}
+
+void SearchServer::RebindWordFrequencies()
+{
+    // Слова документа и его частоты упорядочены одинаково
+    for (auto& [document_id, word_freqs] : document_to_word_freqs_) {
+        auto term = documents_.at(document_id).terms.begin();
+        std::map<std::string_view, double> rebound;
+        for (const auto& word_freq : word_freqs) {
+            rebound.emplace_hint(rebound.end(), index_.GetTerm(*term++), word_freq.second);
+        }
+        word_freqs = std::move(rebound);
+    }
+}
+
+SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view w)
 {
     bool is_minus = false;
 
@@ -207,45 +465,150 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view w) c
     }
 
     return {is_minus ? w.substr(1) : w,
-            is_minus,
-            IsStopWord(w)};
+            is_minus};
 }
 
 SearchServer::Query
-SearchServer::ParseQuery(const std::string_view text, bool cleanup) const
+SearchServer::ParseQuery(const std::string_view text) const
+{
+    std::vector<std::string_view> words;
+    Query query;
+    ParseQuery(text, words, query);
+    return query;
+}
+
+void SearchServer::ParseQuery(const std::string_view text,
+                              std::vector<std::string_view>& words,
+                              Query& query) const
 {
-    if (!IsValidString(text)) {
+    words.clear();
+    query.plus_terms.clear();
+    query.minus_terms.clear();
+    if (!SplitIntoValidWords(text, words)) {
         throw std::invalid_argument("В поисковом запросе недопустимые символы");
     }
-    Query query;
-    for (const std::string_view word : SplitIntoWords(text)) {
+    for (const std::string_view word : words) {
         const QueryWord query_word {ParseQueryWord(word)};
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                query.minus_words.emplace_back(query_word.data);
-            } else {
-                query.plus_words.emplace_back(query_word.data);
-            }
+        if (IsStopWord(word)) continue;
+
+        const TermId term = index_.FindTerm(query_word.data);
+        if (term == InvertedIndex::NO_TERM) continue;
+
+        if (query_word.is_minus) {
+            query.minus_terms.push_back(term);
+        } else {
+            query.plus_terms.push_back(term);
         }
     }
 
-    if (cleanup) {
-        std::sort(query.minus_words.begin(), query.minus_words.end());
-        auto last_m = std::unique(query.minus_words.begin(), query.minus_words.end());
-        query.minus_words.erase(last_m, query.minus_words.end());
+    std::sort(query.minus_terms.begin(), query.minus_terms.end());
+    auto last_m = std::unique(query.minus_terms.begin(), query.minus_terms.end());
+    query.minus_terms.erase(last_m, query.minus_terms.end());
+
+    std::sort(query.plus_terms.begin(), query.plus_terms.end());
+    auto last_p = std::unique(query.plus_terms.begin(), query.plus_terms.end());
+    query.plus_terms.erase(last_p, query.plus_terms.end());
+}
+
+SearchServer::QueryContext& SearchServer::GetThreadQueryContext()
+{
+    thread_local QueryContext context;
+    return context;
+}
 
-        std::sort(query.plus_words.begin(), query.plus_words.end());
-        auto last_p = std::unique(query.plus_words.begin(), query.plus_words.end());
-        query.plus_words.erase(last_p, query.plus_words.end());
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs)
+{
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+        return lhs.rating > rhs.rating;
     }
+    return lhs.relevance > rhs.relevance;
+}
 
-    return query;
+void SearchServer::CollectDocumentFreqs(const std::string_view raw_query,
+                                        DocumentFreqs& document_freqs) const
+{
+    for (const TermId term : ParseQuery(raw_query).plus_terms) {
+        if (const PostingList* postings = index_.Find(term)) {
+            document_freqs.emplace_back(index_.GetTerm(term),
+                                        static_cast<int64_t>(postings->size()));
+        }
+    }
+}
+
+SearchServer::InverseDocumentFreqs
+SearchServer::CombineDocumentFreqs(DocumentFreqs document_freqs, size_t document_count)
+{
+    std::sort(document_freqs.begin(), document_freqs.end());
+
+    // Так же, как в InvertedIndex: log(N / df) = log(N) - log(df)
+    const double log_document_count = std::log(static_cast<double>(document_count));
+    InverseDocumentFreqs inverse_document_freqs;
+    for (size_t i = 0; i < document_freqs.size();) {
+        const std::string_view word = document_freqs[i].first;
+        int64_t document_freq = 0;
+        for (; i < document_freqs.size() && document_freqs[i].first == word; ++i) {
+            document_freq += document_freqs[i].second;
+        }
+        if (document_freq > 0) {
+            inverse_document_freqs.emplace_back(
+                        word, log_document_count - std::log(static_cast<double>(document_freq)));
+        }
+    }
+    return inverse_document_freqs;
+}
+
+double SearchServer::GlobalInverseDocumentFreq::operator()(TermId term, const PostingList&) const
+{
+    const std::string_view word = index.GetTerm(term);
+    const auto it = std::lower_bound(inverse_document_freqs.begin(), inverse_document_freqs.end(),
+                                     word,
+                                     [](const auto& entry, std::string_view w) {
+                                         return entry.first < w;
+                                     });
+    return it != inverse_document_freqs.end() && it->first == word ? it->second : 0.0;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word) const
+size_t SearchServer::DocumentIdRange::width() const
 {
-    return std::log(
-                static_cast<double>(documents_.size()) /
-                static_cast<double>(word_to_document_freqs_.at(word).size())
-                );
+    return static_cast<size_t>(last - first);
+}
+
+size_t SearchServer::GetShardCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void SearchServer::SplitDocumentIdRange(size_t shard_count,
+                                        std::vector<DocumentIdRange>& shards) const
+{
+    const int64_t first_id = *documents_id_.begin();
+    const int64_t total_width = *documents_id_.rbegin() - first_id + 1;
+    const auto count = std::min(static_cast<int64_t>(shard_count), total_width);
+    // Плотный массив выгоднее списка попаданий, пока id документов идут почти подряд
+    const bool dense = total_width <= 4 * static_cast<int64_t>(documents_id_.size());
+
+    shards.clear();
+    for (int64_t i = 0; i < count; ++i) {
+        shards.push_back({static_cast<int>(first_id + total_width * i / count),
+                          first_id + total_width * (i + 1) / count,
+                          dense});
+    }
+}
+
+void SearchServer::FindExcludedDocuments(const Query& query,
+                                         std::vector<int>& excluded_documents) const
+{
+    excluded_documents.clear();
+    for (const TermId term : query.minus_terms) {
+        if (const PostingList* postings = index_.Find(term)) {
+            const auto middle = static_cast<ptrdiff_t>(excluded_documents.size());
+            for (auto cursor = postings->GetCursor(); !cursor.AtEnd(); cursor.Next()) {
+                excluded_documents.push_back(cursor.DocumentId());
+            }
+            std::inplace_merge(excluded_documents.begin(), excluded_documents.begin() + middle,
+                               excluded_documents.end());
+        }
+    }
+    excluded_documents.erase(std::unique(excluded_documents.begin(), excluded_documents.end()),
+                             excluded_documents.end());
 }
@@ -1,17 +1,26 @@
 ﻿#pragma once
 
-#include "concurrent_map.h"
 #include "document.h"
+#include "inverted_index.h"
+#include "relevance_accumulator.h"
+#include "stop_words.h"
+#include "text_arena.h"
+#include "thread_pool.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <execution>
+#include <future>
+#include <limits>
 #include <map>
-#include <mutex>
 #include <numeric>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <vector>
 
 constexpr size_t MAX_RESULT_DOCUMENT_COUNT = 5;
@@ -22,36 +31,132 @@ public:
     SearchServer() = default;
 
     template <typename StringCollection>
-    explicit SearchServer(const StringCollection& stop_words);
-    explicit SearchServer(const std::string& stop_words);
-    explicit SearchServer(const std::string_view stop_words);
+    explicit SearchServer(const StringCollection& stop_words,
+                          PostingFormat posting_format = PostingFormat::PLAIN);
+    explicit SearchServer(const std::string& stop_words,
+                          PostingFormat posting_format = PostingFormat::PLAIN);
+    explicit SearchServer(const std::string_view stop_words,
+                          PostingFormat posting_format = PostingFormat::PLAIN);
+    // Стоп-слова с таблицей, построенной при компиляции
+    template <size_t N>
+    explicit SearchServer(const StaticStopWords<N>& stop_words,
+                          PostingFormat posting_format = PostingFormat::PLAIN);
 
     void AddDocument(int document_id, const std::string_view document,
                      DocumentStatus status, const std::vector<int>& ratings);
 
+    // Добавляет набор RawDocument так же, как последовательные вызовы AddDocument,
+    // но разбивает тексты на слова и строит списки документов параллельно.
+    // Если хотя бы один документ некорректен, не добавляется ни один.
+    template <typename ExecutionPolicy, typename DocumentRange>
+    void AddDocuments(ExecutionPolicy&& policy, const DocumentRange& documents);
+
+    template <typename DocumentRange>
+    void AddDocuments(const DocumentRange& documents);
+
     template<typename ExecutionPolicy>
     std::vector<Document>
     FindTopDocuments(ExecutionPolicy&& policy,
                      const std::string_view raw_query,
-                     DocumentStatus status = DocumentStatus::ACTUAL) const;
+                     DocumentStatus status = DocumentStatus::ACTUAL,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template<typename Predicate>
     std::vector<Document>
-    FindTopDocuments(const std::string_view raw_query, Predicate predicate) const;
+    FindTopDocuments(const std::string_view raw_query, Predicate predicate,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template<typename Predicate, typename ExecutionPolicy>
     std::vector<Document>
     FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query,
-                     Predicate predicate) const;
+                     Predicate predicate,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     std::vector<Document>
     FindTopDocuments(const std::string_view raw_query,
-                     DocumentStatus status = DocumentStatus::ACTUAL) const;
+                     DocumentStatus status = DocumentStatus::ACTUAL,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Буферы для разбора запроса, подсчёта релевантности и результатов.
+    // Когда буферы достигают нужного размера, поиск перестаёт выделять память.
+    // Один контекст нельзя использовать одновременно из нескольких потоков.
+    class QueryContext;
+
+    // Результат хранится в context и действителен до следующего поиска с ним
+    template<typename Predicate>
+    const std::vector<Document>&
+    FindTopDocuments(QueryContext& context, const std::string_view raw_query,
+                     Predicate predicate,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    const std::vector<Document>&
+    FindTopDocuments(QueryContext& context, const std::string_view raw_query,
+                     DocumentStatus status = DocumentStatus::ACTUAL,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Ставит поиск в очередь пула и сразу возвращает его будущий результат.
+    // Запрос копируется, но сервер не должен меняться, пока поиск не завершён
+    template<typename Predicate>
+    std::future<std::vector<Document>>
+    FindTopDocumentsAsync(ThreadPool& pool, const std::string_view raw_query,
+                          Predicate predicate,
+                          size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::future<std::vector<Document>>
+    FindTopDocumentsAsync(ThreadPool& pool, const std::string_view raw_query,
+                          DocumentStatus status = DocumentStatus::ACTUAL,
+                          size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Выполняет пачку запросов и возвращает для каждого те же документы,
+    // что и FindTopDocuments. Каждый поток берёт свою часть запросов и обходит
+    // список документов каждого слова один раз сразу для всех запросов
+    // части, в которых оно встречается.
+    template<typename ExecutionPolicy>
+    std::vector<std::vector<Document>>
+    FindTopDocumentsBatch(ExecutionPolicy&& policy, const std::vector<std::string>& raw_queries,
+                          DocumentStatus status = DocumentStatus::ACTUAL,
+                          size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<std::vector<Document>>
+    FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                          DocumentStatus status = DocumentStatus::ACTUAL,
+                          size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // То же, но документы всех запросов записываются подряд в documents без
+    // отдельного массива на запрос: документы запроса i лежат в documents
+    // с offsets[i] по offsets[i + 1]
+    template<typename ExecutionPolicy>
+    void FindTopDocumentsBatch(ExecutionPolicy&& policy, const std::vector<std::string>& raw_queries,
+                               std::vector<Document>& documents, std::vector<size_t>& offsets,
+                               DocumentStatus status = DocumentStatus::ACTUAL,
+                               size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Возвращают те же документы, что и FindTopDocuments, но пропускают
+    // документы, которые заведомо не попадут в результат (алгоритм MaxScore)
+    template<typename Predicate>
+    std::vector<Document>
+    FindTopDocumentsWithPruning(const std::string_view raw_query, Predicate predicate,
+                                size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document>
+    FindTopDocumentsWithPruning(const std::string_view raw_query,
+                                DocumentStatus status = DocumentStatus::ACTUAL,
+                                size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     int GetDocumentCount() const;
 
-    std::set<int>::const_iterator begin();
-    std::set<int>::const_iterator end();
+    // Номер версии индекса, меняется при каждом добавлении и удалении документов
+    // и никогда не повторяется, даже у разных серверов.
+    // Результат поиска, полученный при той же версии, остаётся верным.
+    uint64_t GetEpoch() const;
+
+    // Ключ запроса, одинаковый у запросов с одинаковыми результатами поиска
+    // при текущей версии индекса: упорядоченные номера плюс- и минус-слов
+    // без повторов, стоп-слов и слов, которых нет в индексе
+    std::string GetQueryKey(const std::string_view raw_query) const;
+
+    std::set<int>::const_iterator begin() const;
+    std::set<int>::const_iterator end() const;
 
     using MatchedDocument = std::tuple<std::vector<std::string_view>, DocumentStatus>;
     MatchedDocument MatchDocument(const std::string_view raw_query, int document_id) const;
@@ -67,97 +172,376 @@ public:
 
     void RemoveDocument(int document_id);
 
+    // Удаляет пачку документов: список каждого слова обходится один раз,
+    // а слова, не оставшиеся ни в одном документе, удаляются из словаря.
+    // Если какого-то документа нет, не удаляется ни один.
+    template <typename ExecutionPolicy>
+    void RemoveDocuments(ExecutionPolicy&& policy, std::vector<int> document_ids);
+
+    void RemoveDocuments(std::vector<int> document_ids);
+
+    // Сохраняет индекс в файл, который можно открыть через IndexSnapshot
+    void SaveSnapshot(const std::string& path) const;
+
+    // Память, занятая списками документов индекса
+    size_t GetPostingsMemoryUsage() const;
+
+    // Порядок документов в результатах поиска
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
 private:
+    friend class ConcurrentSearchServer;
+    friend class IndexSnapshot;
+    friend class QueryEvaluation;
+    friend class SegmentedSearchServer;
+    friend class ShardedSearchServer;
+
+    using TermId = InvertedIndex::TermId;
+
+    // content указывает в document_texts_
     struct DocumentData {
         int rating;
         DocumentStatus status;
-        std::string content;
+        std::string_view content;
+        std::vector<TermId> terms;
     };
 
+    // Версия индекса. Значения берутся из общего для процесса счётчика
+    // и никогда не повторяются, в том числе у разных серверов: копия,
+    // перемещённый сервер и сервер, из которого переместили, получают новые
+    struct Epoch {
+        uint64_t value = Next();
+
+        Epoch() = default;
+        Epoch(const Epoch&) {}
+        Epoch(Epoch&& other) noexcept { other.Advance(); }
+        Epoch& operator=(const Epoch&) { Advance(); return *this; }
+        Epoch& operator=(Epoch&& other) noexcept { Advance(); other.Advance(); return *this; }
+
+        void Advance() { value = Next(); }
+        static uint64_t Next();
+    };
+
+    // Слова запроса, переведённые в номера слов индекса, без повторов.
+    // Слова, которых нет в индексе, ни на что не влияют и отбрасываются.
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
     };
 
-    std::set<std::string, std::less<>> stop_words_{};
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_{};
+    StopWords stop_words_{};
+    InvertedIndex index_{};
     std::map<int, std::map<std::string_view, double>> document_to_word_freqs_{};
     std::map<int, DocumentData> documents_{};
     std::set<int> documents_id_{};
+    TextArena document_texts_{};
+    size_t removed_text_size_ = 0;
+    Epoch epoch_{};
 
     static bool IsValidString(const std::string_view word);
     bool IsStopWord(const std::string_view word) const;
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text) const;
-
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    // Слова документа без стоп-слов в порядке возрастания и их частоты.
+    // Текст разбирается и проверяется за один проход; возвращает false,
+    // если в тексте есть недопустимые символы
+    using WordFreqs = std::vector<std::pair<std::string_view, double>>;
+    bool ComputeWordFreqs(const std::string_view text, WordFreqs& word_freqs) const;
+
+    void CheckNewDocument(int document_id, bool is_valid_text) const;
+    void CheckNewDocuments(const std::vector<const RawDocument*>& documents,
+                           const std::vector<char>& valid_texts) const;
+    DocumentData& RegisterDocument(int document_id, const std::string_view document,
+                                   DocumentStatus status, const std::vector<int>& ratings,
+                                   const WordFreqs& word_freqs);
+
+    void ReleaseDocumentText(size_t text_size);
+    // Переводит ключи document_to_word_freqs_ на строки слов индекса
+    // после того, как индекс переложил их в новое хранилище
+    void RebindWordFrequencies();
+
+    // Упорядочивает записи по словам и id документов и вызывает
+    // action(first, last) для записей каждого слова с заданной политикой
+    template <typename ExecutionPolicy, typename TermAction>
+    static void ForEachTermPostings(ExecutionPolicy&& policy,
+                                    std::vector<InvertedIndex::Posting>& postings,
+                                    TermAction action);
+
     struct QueryWord {
         std::string_view data;
         bool is_minus;
-        bool is_stop;
     };
 
-    QueryWord ParseQueryWord(const std::string_view) const;
-    Query ParseQuery(const std::string_view text, bool cleanup = true) const;
+    static QueryWord ParseQueryWord(const std::string_view);
+    Query ParseQuery(const std::string_view text) const;
+    void ParseQuery(const std::string_view text,
+                    std::vector<std::string_view>& words, Query& query) const;
+
+    // Контекст текущего потока для поиска без явного QueryContext
+    static QueryContext& GetThreadQueryContext();
+
+    // Полуинтервал id документов [first, last), обрабатываемый одним потоком
+    struct DocumentIdRange {
+        int first;
+        int64_t last;
+        bool dense;
+
+        size_t width() const;
+    };
+
+    static size_t GetShardCount();
+    // Число частей, на которые делится работа при данной политике
+    template<typename ExecutionPolicy>
+    static size_t GetShardCount(const ExecutionPolicy& policy);
+    void SplitDocumentIdRange(size_t shard_count, std::vector<DocumentIdRange>& shards) const;
+
+    // Выполняет запросы [first, last) пачки, дописывая их документы по порядку
+    // в documents и записывая их число в counts[query]
+    void FindTopDocumentsBatch(const std::vector<Query>& queries, size_t first, size_t last,
+                               DocumentStatus status, size_t result_count,
+                               std::vector<Document>& documents,
+                               std::vector<size_t>& counts) const;
+
+    // Разбирает запросы пачки, делит их на части по числу потоков и выполняет
+    // части параллельно. Документы части chunk лежат в chunk_documents[chunk],
+    // первый запрос части - GetBatchChunkBegin(chunk, ...)
+    template<typename ExecutionPolicy>
+    void FindTopDocumentsBatchChunks(ExecutionPolicy&& policy,
+                                     const std::vector<std::string>& raw_queries,
+                                     DocumentStatus status, size_t result_count,
+                                     std::vector<std::vector<Document>>& chunk_documents,
+                                     std::vector<size_t>& counts) const;
+    static size_t GetBatchChunkBegin(size_t chunk, size_t chunk_count, size_t query_count);
+
+    // candidates - буфер для лучших документов отдельных кусков
+    template<typename ExecutionPolicy>
+    static void SelectTopDocuments(ExecutionPolicy&& policy,
+                                   std::vector<Document>& documents,
+                                   std::vector<Document>& candidates,
+                                   size_t result_count);
+
+    void FindExcludedDocuments(const Query& query, std::vector<int>& excluded_documents) const;
+
+    // Курсор по списку документов слова запроса и наибольший вклад слова в релевантность
+    struct TermCursor : PostingList::Cursor {
+        double inverse_document_freq;
+        double max_score;
+
+        double Score() const { return TermFreq() * inverse_document_freq; }
+    };
+
+    // IDF слова по собственному индексу
+    struct LocalInverseDocumentFreq {
+        const InvertedIndex& index;
+
+        double operator()(TermId, const PostingList& postings) const
+        {
+            return index.GetInverseDocumentFreq(postings);
+        }
+    };
+
+    // IDF слов запроса по нескольким индексам (шардам или сегментам).
+    // Упорядочены по слову
+    using InverseDocumentFreqs = std::vector<std::pair<std::string_view, double>>;
+    // Число документов с каждым словом; слова могут повторяться
+    using DocumentFreqs = std::vector<std::pair<std::string_view, int64_t>>;
+
+    // Добавляет в document_freqs плюс-слова запроса, которые есть в индексе
+    void CollectDocumentFreqs(const std::string_view raw_query, DocumentFreqs& document_freqs) const;
+    // Складывает частоты одинаковых слов; слова с нулевой суммой отбрасываются
+    static InverseDocumentFreqs CombineDocumentFreqs(DocumentFreqs document_freqs,
+                                                     size_t document_count);
 
-    double ComputeWordInverseDocumentFreq(const std::string_view word) const;
+    // IDF слова по всем индексам
+    struct GlobalInverseDocumentFreq {
+        const InvertedIndex& index;
+        const InverseDocumentFreqs& inverse_document_freqs;
 
-    template<typename ExecutionPolicy, typename Predicate>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy,
-                                           const Query& query,
-                                           Predicate predicate) const;
+        double operator()(TermId term, const PostingList&) const;
+    };
+
+    // Оставляет в context лучшие документы запроса. inverse_document_freq(term, postings)
+    // возвращает IDF слова; для поиска по нескольким индексам это GlobalInverseDocumentFreq
+    template<typename ExecutionPolicy, typename Predicate, typename InverseDocumentFreq>
+    const std::vector<Document>&
+    FindTopDocuments(ExecutionPolicy&& policy, QueryContext& context,
+                     const std::string_view raw_query, Predicate predicate,
+                     size_t result_count, InverseDocumentFreq inverse_document_freq) const;
+
+    template<typename Predicate>
+    void FindTopDocumentsWithPruning(QueryContext& context, const std::string_view raw_query,
+                                     Predicate predicate, size_t result_count) const;
+
+    // Оставляет в context все подходящие документы запроса
+    template<typename ExecutionPolicy, typename Predicate, typename InverseDocumentFreq>
+    void FindAllDocuments(ExecutionPolicy&& policy, QueryContext& context,
+                          Predicate predicate, InverseDocumentFreq inverse_document_freq) const;
+
+    // Добавляет в accumulator вклады записей списка от cursor до документа last_document_id
+    // (не включая), пропуская документы excluded_documents; excluded - позиция в нём.
+    // Обходит не больше posting_limit записей и возвращает число обойдённых
+    template<typename Predicate>
+    size_t ScorePostings(PostingList::Cursor& cursor, int64_t last_document_id,
+                         double inverse_document_freq,
+                         const std::vector<int>& excluded_documents,
+                         std::vector<int>::const_iterator& excluded,
+                         Predicate& predicate, RelevanceAccumulator& accumulator,
+                         size_t posting_limit = std::numeric_limits<size_t>::max()) const;
+};
+
+class SearchServer::QueryContext {
+public:
+    QueryContext() = default;
+
+private:
+    friend class SearchServer;
+
+    std::vector<std::string_view> words_{};
+    Query query_{};
+    std::vector<int> excluded_documents_{};
+    std::vector<const PostingList*> plus_postings_{};
+    std::vector<double> inverse_document_freqs_{};
+    std::vector<DocumentIdRange> shards_{};
+    std::vector<RelevanceAccumulator> accumulators_{};
+    std::vector<std::vector<Document>> shard_documents_{};
+    std::vector<TermCursor> cursors_{};
+    std::vector<double> max_score_sums_{};
+    std::vector<Document> candidates_{};
+    std::vector<Document> documents_{};
 };
 
 template <typename StringCollection>
-SearchServer::SearchServer(const StringCollection& stop_words) {
+SearchServer::SearchServer(const StringCollection& stop_words, PostingFormat posting_format)
+    : index_{posting_format}
+{
+    std::vector<std::string> words;
     for (const std::string_view word : stop_words) {
-        if (word.empty()) continue;
         if (!IsValidString(word)) {
             throw std::invalid_argument("В стоп-слове недопустимые символы");
         }
-        stop_words_.emplace(std::string(word));
+        words.emplace_back(word);
+    }
+    stop_words_ = StopWords(std::move(words));
+}
+
+template <size_t N>
+SearchServer::SearchServer(const StaticStopWords<N>& stop_words, PostingFormat posting_format)
+    : stop_words_{stop_words},
+      index_{posting_format}
+{
+    for (const std::string_view word : stop_words.GetWords()) {
+        if (!IsValidString(word)) {
+            throw std::invalid_argument("В стоп-слове недопустимые символы");
+        }
+    }
+}
+
+template<typename ExecutionPolicy>
+size_t SearchServer::GetShardCount(const ExecutionPolicy& policy)
+{
+    if constexpr (IsThreadPoolPolicy<ExecutionPolicy>()) {
+        return policy.pool.GetThreadCount();
+    } else if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+        return 1;
+    } else {
+        return GetShardCount();
+    }
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::SelectTopDocuments(ExecutionPolicy&& policy,
+                                      std::vector<Document>& documents,
+                                      std::vector<Document>& candidates,
+                                      size_t result_count)
+{
+    const size_t chunk_count = GetShardCount(policy);
+    const size_t chunk_size = documents.size() / chunk_count;
+
+    // Каждый кусок оставляет у себя не больше result_count лучших документов,
+    // после чего лучшие выбираются уже среди кандидатов
+    if (chunk_count > 1 && chunk_size > result_count) {
+        std::vector<size_t> chunks(chunk_count);
+        std::iota(chunks.begin(), chunks.end(), 0);
+        ForEach(policy, chunks.begin(), chunks.end(),
+                [&documents, chunk_size, chunk_count, result_count](size_t chunk) {
+            const auto first = documents.begin() + static_cast<ptrdiff_t>(chunk * chunk_size);
+            const auto last = chunk + 1 == chunk_count
+                    ? documents.end()
+                    : first + static_cast<ptrdiff_t>(chunk_size);
+            std::partial_sort(first, first + static_cast<ptrdiff_t>(result_count), last,
+                              IsMoreRelevant);
+        });
+
+        candidates.clear();
+        for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+            const auto first = documents.begin() + static_cast<ptrdiff_t>(chunk * chunk_size);
+            candidates.insert(candidates.end(), first,
+                              first + static_cast<ptrdiff_t>(result_count));
+        }
+        documents.swap(candidates);
     }
+
+    const size_t top_count = std::min(documents.size(), result_count);
+    std::partial_sort(documents.begin(),
+                      documents.begin() + static_cast<ptrdiff_t>(top_count),
+                      documents.end(),
+                      IsMoreRelevant);
+    documents.resize(top_count);
 }
 
 template<typename Predicate, typename ExecutionPolicy>
 std::vector<Document>
 SearchServer::FindTopDocuments(ExecutionPolicy&& policy,
                                const std::string_view raw_query,
-                               Predicate predicate) const
-{
-    using namespace std::literals;
-    const Query query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(policy, query, predicate);
-
-    std::sort(policy, matched_documents.begin(), matched_documents.end(),
-         [](const Document& lhs, const Document& rhs) {
-             if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                 return lhs.rating > rhs.rating;
-             } else {
-                 return lhs.relevance > rhs.relevance;
-             }
-    });
+                               Predicate predicate,
+                               size_t result_count) const
+{
+    return FindTopDocuments(policy, GetThreadQueryContext(), raw_query, predicate,
+                            result_count, LocalInverseDocumentFreq{index_});
+}
 
-    matched_documents.resize(std::min(matched_documents.size(),
-                                      MAX_RESULT_DOCUMENT_COUNT));
+template<typename Predicate>
+const std::vector<Document>&
+SearchServer::FindTopDocuments(QueryContext& context,
+                               const std::string_view raw_query,
+                               Predicate predicate,
+                               size_t result_count) const
+{
+    return FindTopDocuments(std::execution::seq, context, raw_query, predicate,
+                            result_count, LocalInverseDocumentFreq{index_});
+}
 
-    return matched_documents;
+template<typename ExecutionPolicy, typename Predicate, typename InverseDocumentFreq>
+const std::vector<Document>&
+SearchServer::FindTopDocuments(ExecutionPolicy&& policy,
+                               QueryContext& context,
+                               const std::string_view raw_query,
+                               Predicate predicate,
+                               size_t result_count,
+                               InverseDocumentFreq inverse_document_freq) const
+{
+    ParseQuery(raw_query, context.words_, context.query_);
+    FindAllDocuments(policy, context, predicate, inverse_document_freq);
+    SelectTopDocuments(policy, context.documents_, context.candidates_, result_count);
+    return context.documents_;
 }
 
 template<typename Predicate>
 std::vector<Document>
 SearchServer::FindTopDocuments(const std::string_view raw_query,
-                               Predicate predicate) const
+                               Predicate predicate,
+                               size_t result_count) const
 {
-    return FindTopDocuments(std::execution::seq, raw_query, predicate);
+    return FindTopDocuments(std::execution::seq, raw_query, predicate, result_count);
 }
 
 template<typename ExecutionPolicy>
 std::vector<Document>
 SearchServer::FindTopDocuments(ExecutionPolicy&& policy,
                                const std::string_view raw_query,
-                               DocumentStatus status) const
+                               DocumentStatus status,
+                               size_t result_count) const
 {
     const auto predicate = [status]([[maybe_unused]] int document_id,
                                     DocumentStatus s,
@@ -165,87 +549,430 @@ SearchServer::FindTopDocuments(ExecutionPolicy&& policy,
                                     {
                                         return s == status;
                                     };
-    return FindTopDocuments(policy, raw_query, predicate);
+    return FindTopDocuments(policy, raw_query, predicate, result_count);
 }
 
-template<typename ExecutionPolicy, typename Predicate>
+template<typename Predicate>
 std::vector<Document>
-SearchServer::FindAllDocuments(ExecutionPolicy&& policy,
-                               const Query& query,
-                               Predicate predicate) const
+SearchServer::FindTopDocumentsWithPruning(const std::string_view raw_query,
+                                          Predicate predicate,
+                                          size_t result_count) const
 {
-    ConcurrentMap<int, double> document_to_relevance(64);
-    ConcurrentSet<int> useless_documents(64);
+    QueryContext& context = GetThreadQueryContext();
+    FindTopDocumentsWithPruning(context, raw_query, predicate, result_count);
+    return context.documents_;
+}
 
-    std::for_each(policy,
-                  query.minus_words.begin(),
-                  query.minus_words.end(),
-                  [this, &useless_documents](std::string_view word)
-    {
-        if (word_to_document_freqs_.count(word) != 0) {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                useless_documents.Insert(document_id);
+template<typename Predicate>
+void SearchServer::FindTopDocumentsWithPruning(QueryContext& context,
+                                               const std::string_view raw_query,
+                                               Predicate predicate,
+                                               size_t result_count) const
+{
+    ParseQuery(raw_query, context.words_, context.query_);
+    const Query& query = context.query_;
+    // Куча с наименее релевантным из лучших документов в вершине.
+    // Документ с релевантностью ниже threshold уже не может в неё попасть.
+    std::vector<Document>& top_documents = context.documents_;
+    top_documents.clear();
+    if (result_count == 0) return;
+
+    std::vector<TermCursor>& cursors = context.cursors_;
+    cursors.clear();
+    for (const TermId term : query.plus_terms) {
+        if (const PostingList* postings = index_.Find(term)) {
+            const double inverse_document_freq = index_.GetInverseDocumentFreq(*postings);
+            cursors.push_back({postings->GetCursor(), inverse_document_freq,
+                               postings->max_term_freq * inverse_document_freq});
+        }
+    }
+    std::sort(cursors.begin(), cursors.end(),
+              [](const TermCursor& lhs, const TermCursor& rhs) {
+                  return lhs.max_score < rhs.max_score;
+              });
+
+    // max_score_sums[i] - наибольший суммарный вклад слов с 0 по i
+    std::vector<double>& max_score_sums = context.max_score_sums_;
+    max_score_sums.resize(cursors.size());
+    double max_score_sum = 0.0;
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        max_score_sum += cursors[i].max_score;
+        max_score_sums[i] = max_score_sum;
+    }
+
+    const std::vector<int>& excluded_documents = context.excluded_documents_;
+    FindExcludedDocuments(query, context.excluded_documents_);
+    auto excluded = excluded_documents.begin();
+
+    double threshold = -std::numeric_limits<double>::infinity();
+    // Слова до first_essential не могут сами по себе вывести документ в результат
+    size_t first_essential = 0;
+
+    while (true) {
+        int document_id = std::numeric_limits<int>::max();
+        bool found = false;
+        for (size_t i = first_essential; i < cursors.size(); ++i) {
+            if (!cursors[i].AtEnd() && cursors[i].DocumentId() <= document_id) {
+                document_id = cursors[i].DocumentId();
+                found = true;
+            }
+        }
+        if (!found) break;
+
+        double relevance = 0.0;
+        for (size_t i = first_essential; i < cursors.size(); ++i) {
+            TermCursor& cursor = cursors[i];
+            if (!cursor.AtEnd() && cursor.DocumentId() == document_id) {
+                relevance += cursor.Score();
+                cursor.Next();
             }
         }
-    });
 
-    auto plus_predicate = [this, &document_to_relevance,
-                          &useless_documents, &predicate] (std::string_view word)
-    {
-        if (word_to_document_freqs_.count(word) != 0) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            const auto& docs_freqs = word_to_document_freqs_.at(word);
-            for (const auto& [document_id, term_freq] : docs_freqs) {
-                if (useless_documents.Count(document_id) > 0) continue;
-
-                const auto& document = documents_.at(document_id);
-                if (predicate(document_id, document.status, document.rating)) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                }
+        bool pruned = false;
+        for (size_t i = first_essential; i-- > 0;) {
+            if (relevance + max_score_sums[i] < threshold) {
+                pruned = true;
+                break;
+            }
+            TermCursor& cursor = cursors[i];
+            cursor.Seek(document_id);
+            if (!cursor.AtEnd() && cursor.DocumentId() == document_id) {
+                relevance += cursor.Score();
             }
         }
-    };
+        if (pruned || relevance < threshold) continue;
+
+        excluded = std::lower_bound(excluded, excluded_documents.end(), document_id);
+        if (excluded != excluded_documents.end() && *excluded == document_id) continue;
+
+        const auto& document = documents_.at(document_id);
+        if (!predicate(document_id, document.status, document.rating)) continue;
+
+        const Document candidate {document_id, relevance, document.rating};
+        if (top_documents.size() < result_count) {
+            top_documents.push_back(candidate);
+            std::push_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+        } else if (IsMoreRelevant(candidate, top_documents.front())) {
+            std::pop_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+            top_documents.back() = candidate;
+            std::push_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+        } else {
+            continue;
+        }
+
+        if (top_documents.size() == result_count) {
+            threshold = top_documents.front().relevance - EPSILON;
+            while (first_essential < cursors.size()
+                   && max_score_sums[first_essential] < threshold) {
+                ++first_essential;
+            }
+        }
+    }
+
+    std::sort_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+}
+
+template<typename ExecutionPolicy, typename Predicate, typename InverseDocumentFreq>
+void SearchServer::FindAllDocuments(ExecutionPolicy&& policy,
+                                    QueryContext& context,
+                                    Predicate predicate,
+                                    InverseDocumentFreq inverse_document_freq) const
+{
+    std::vector<Document>& matched_documents = context.documents_;
+    matched_documents.clear();
+    if (documents_id_.empty()) return;
+
+    const std::vector<int>& excluded_documents = context.excluded_documents_;
+    FindExcludedDocuments(context.query_, context.excluded_documents_);
+
+    std::vector<const PostingList*>& plus_postings = context.plus_postings_;
+    std::vector<double>& inverse_document_freqs = context.inverse_document_freqs_;
+    plus_postings.clear();
+    inverse_document_freqs.clear();
+    for (const TermId term : context.query_.plus_terms) {
+        if (const PostingList* postings = index_.Find(term)) {
+            plus_postings.push_back(postings);
+            inverse_document_freqs.push_back(inverse_document_freq(term, *postings));
+        }
+    }
+
+    const std::vector<DocumentIdRange>& shards = context.shards_;
+    SplitDocumentIdRange(GetShardCount(policy), context.shards_);
+    // Буферы только добавляются, чтобы не терять память, выделенную под прошлые запросы
+    if (context.accumulators_.size() < shards.size()) {
+        context.accumulators_.resize(shards.size());
+        context.shard_documents_.resize(shards.size());
+    }
+
+    ForEach(policy, shards.begin(), shards.end(),
+            [&](const DocumentIdRange& shard)
+    {
+        const auto shard_index = static_cast<size_t>(&shard - shards.data());
+        RelevanceAccumulator& accumulator = context.accumulators_[shard_index];
+        accumulator.Reset(shard.first, shard.width(), shard.dense);
+        const auto shard_excluded = std::lower_bound(excluded_documents.begin(),
+                                                     excluded_documents.end(),
+                                                     shard.first);
+        for (size_t word = 0; word < plus_postings.size(); ++word) {
+            PostingList::Cursor cursor = plus_postings[word]->GetCursor();
+            cursor.Seek(shard.first);
+            auto excluded = shard_excluded;
+            ScorePostings(cursor, shard.last, inverse_document_freqs[word],
+                          excluded_documents, excluded, predicate, accumulator);
+        }
+
+        auto& matched = context.shard_documents_[shard_index];
+        matched.clear();
+        accumulator.ForEach([this, &matched](int document_id, double relevance) {
+            matched.emplace_back(document_id, relevance, documents_.at(document_id).rating);
+        });
+    });
+
+    for (size_t shard = 0; shard < shards.size(); ++shard) {
+        const auto& documents = context.shard_documents_[shard];
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+}
+
+template<typename Predicate>
+size_t SearchServer::ScorePostings(PostingList::Cursor& cursor, int64_t last_document_id,
+                                   double inverse_document_freq,
+                                   const std::vector<int>& excluded_documents,
+                                   std::vector<int>::const_iterator& excluded,
+                                   Predicate& predicate, RelevanceAccumulator& accumulator,
+                                   size_t posting_limit) const
+{
+    size_t processed = 0;
+    for (; processed < posting_limit && !cursor.AtEnd() && cursor.DocumentId() < last_document_id;
+         cursor.Next(), ++processed) {
+        const int document_id = cursor.DocumentId();
+        while (excluded != excluded_documents.end() && *excluded < document_id) {
+            ++excluded;
+        }
+        if (excluded != excluded_documents.end() && *excluded == document_id) continue;
+
+        const auto& document = documents_.at(document_id);
+        if (predicate(document_id, document.status, document.rating)) {
+            accumulator.Add(document_id, cursor.TermFreq() * inverse_document_freq);
+        }
+    }
+    return processed;
+}
+
+template<typename Predicate>
+std::future<std::vector<Document>>
+SearchServer::FindTopDocumentsAsync(ThreadPool& pool,
+                                    const std::string_view raw_query,
+                                    Predicate predicate,
+                                    size_t result_count) const
+{
+    return pool.Submit([this, query = std::string(raw_query), predicate, result_count] {
+        return FindTopDocuments(std::execution::seq, query, predicate, result_count);
+    });
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::FindTopDocumentsBatchChunks(ExecutionPolicy&& policy,
+                                               const std::vector<std::string>& raw_queries,
+                                               DocumentStatus status, size_t result_count,
+                                               std::vector<std::vector<Document>>& chunk_documents,
+                                               std::vector<size_t>& counts) const
+{
+    // Исключение из алгоритма с политикой выполнения завершило бы программу,
+    // поэтому ошибка разбора запроса выбрасывается уже после него
+    std::vector<Query> queries(raw_queries.size());
+    std::vector<std::exception_ptr> errors(raw_queries.size());
+    std::vector<size_t> indexes(raw_queries.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    ForEach(policy, indexes.begin(), indexes.end(), [&](size_t index) {
+        try {
+            queries[index] = ParseQuery(raw_queries[index]);
+        } catch (...) {
+            errors[index] = std::current_exception();
+        }
+    });
+    for (const std::exception_ptr& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+
+    // Чем больше запросов в части, тем чаще их слова совпадают,
+    // поэтому частей столько, сколько потоков
+    const size_t chunk_count = std::min(queries.size(), GetShardCount(policy));
+    std::vector<size_t> chunks(chunk_count);
+    std::iota(chunks.begin(), chunks.end(), 0);
+    chunk_documents.assign(chunk_count, {});
+    counts.assign(queries.size(), 0);
+    ForEach(policy, chunks.begin(), chunks.end(), [&](size_t chunk) {
+        FindTopDocumentsBatch(queries, GetBatchChunkBegin(chunk, chunk_count, queries.size()),
+                              GetBatchChunkBegin(chunk + 1, chunk_count, queries.size()),
+                              status, result_count, chunk_documents[chunk], counts);
+    });
+}
+
+template<typename ExecutionPolicy>
+std::vector<std::vector<Document>>
+SearchServer::FindTopDocumentsBatch(ExecutionPolicy&& policy,
+                                    const std::vector<std::string>& raw_queries,
+                                    DocumentStatus status,
+                                    size_t result_count) const
+{
+    std::vector<std::vector<Document>> chunk_documents;
+    std::vector<size_t> counts;
+    FindTopDocumentsBatchChunks(policy, raw_queries, status, result_count,
+                                chunk_documents, counts);
+
+    std::vector<std::vector<Document>> results(raw_queries.size());
+    for (size_t chunk = 0; chunk < chunk_documents.size(); ++chunk) {
+        auto documents = chunk_documents[chunk].begin();
+        for (size_t query = GetBatchChunkBegin(chunk, chunk_documents.size(), results.size());
+             query < GetBatchChunkBegin(chunk + 1, chunk_documents.size(), results.size());
+             ++query) {
+            const auto count = static_cast<ptrdiff_t>(counts[query]);
+            results[query].assign(documents, documents + count);
+            documents += count;
+        }
+    }
+    return results;
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::FindTopDocumentsBatch(ExecutionPolicy&& policy,
+                                         const std::vector<std::string>& raw_queries,
+                                         std::vector<Document>& documents,
+                                         std::vector<size_t>& offsets,
+                                         DocumentStatus status,
+                                         size_t result_count) const
+{
+    std::vector<std::vector<Document>> chunk_documents;
+    FindTopDocumentsBatchChunks(policy, raw_queries, status, result_count,
+                                chunk_documents, offsets);
+
+    // Размеры результатов известны, поэтому смещения считаются до копирования,
+    // и каждая часть пишет сразу на своё место в documents
+    offsets.insert(offsets.begin(), 0);
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    documents.resize(offsets.back());
+    std::vector<size_t> chunks(chunk_documents.size());
+    std::iota(chunks.begin(), chunks.end(), 0);
+    ForEach(policy, chunks.begin(), chunks.end(), [&](size_t chunk) {
+        const size_t first = GetBatchChunkBegin(chunk, chunks.size(), raw_queries.size());
+        std::copy(chunk_documents[chunk].begin(), chunk_documents[chunk].end(),
+                  documents.begin() + static_cast<ptrdiff_t>(offsets[first]));
+    });
+}
+
+template <typename ExecutionPolicy, typename DocumentRange>
+void SearchServer::AddDocuments(ExecutionPolicy&& policy, const DocumentRange& documents)
+{
+    std::vector<const RawDocument*> batch;
+    for (const RawDocument& document : documents) {
+        batch.push_back(&document);
+    }
+
+    std::vector<WordFreqs> word_freqs(batch.size());
+    std::vector<char> valid_texts(batch.size());
+    ForEach(policy, batch.begin(), batch.end(),
+            [this, &batch, &word_freqs, &valid_texts](const RawDocument* const& document) {
+        const size_t i = static_cast<size_t>(&document - batch.data());
+        valid_texts[i] = ComputeWordFreqs(document->text, word_freqs[i]);
+    });
+    CheckNewDocuments(batch, valid_texts);
+
+    std::vector<InvertedIndex::Posting> postings;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const RawDocument& document = *batch[i];
+        const DocumentData& data = RegisterDocument(document.id, document.text,
+                                                    document.status, document.ratings,
+                                                    word_freqs[i]);
+        for (size_t j = 0; j < data.terms.size(); ++j) {
+            postings.push_back({data.terms[j], document.id, word_freqs[i][j].second});
+        }
+    }
 
-    std::for_each(policy,
-                  query.plus_words.begin(),
-                  query.plus_words.end(),
-                  plus_predicate);
+    ForEachTermPostings(policy, postings, [this](auto first, auto last) {
+        index_.AddSorted(first, last);
+    });
 
-    std::map<int,double> om = document_to_relevance.BuildOrdinaryMap();
-    std::vector<Document> matched_documents(om.size());
-    std::transform(policy,
-                   om.begin(),
-                   om.end(),
-                   matched_documents.begin(),
-                   [this](const auto& pair){
-                        return Document(pair.first,
-                                        pair.second,
-                                        documents_.at(pair.first).rating);
-                    }
-    );
+    index_.SetDocumentCount(documents_.size());
+    epoch_.Advance();
+}
 
-    return matched_documents;
+template <typename DocumentRange>
+void SearchServer::AddDocuments(const DocumentRange& documents)
+{
+    AddDocuments(std::execution::seq, documents);
 }
 
 template <typename ExecutionPolicy>
 void SearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id)
 {
-    const auto& words {document_to_word_freqs_.at(document_id)};
+    RemoveDocuments(policy, std::vector<int>{document_id});
+}
 
-    std::vector<const std::string*> words_key(words.size());
-    std::transform(policy,
-                   words.begin(),
-                   words.end(),
-                   words_key.begin(),
-                   [](const auto& pair){return &pair.first; }
-    );
+template <typename ExecutionPolicy>
+void SearchServer::RemoveDocuments(ExecutionPolicy&& policy, std::vector<int> document_ids)
+{
+    std::sort(document_ids.begin(), document_ids.end());
+    document_ids.erase(std::unique(document_ids.begin(), document_ids.end()), document_ids.end());
+    for (const int document_id : document_ids) {
+        if (documents_id_.count(document_id) == 0) throw std::out_of_range("No document");
+    }
 
-    std::for_each(policy, words_key.begin(), words_key.end(),
-                  [&document_id, this](const std::string* s) {
-                   word_to_document_freqs_.at(*s).erase(document_id);
+    std::vector<InvertedIndex::Posting> postings;
+    for (const int document_id : document_ids) {
+        for (const TermId term : documents_.at(document_id).terms) {
+            postings.push_back({term, document_id, 0.0});
+        }
+    }
+    ForEachTermPostings(policy, postings, [this](auto first, auto last) {
+        index_.RemoveSorted(first, last);
     });
 
-    document_to_word_freqs_.erase(document_id);
-    documents_.erase(document_id);
-    documents_id_.erase(document_id);
+    std::vector<TermId> empty_terms;
+    for (size_t i = 0; i < postings.size(); ++i) {
+        if ((i == 0 || postings[i].term != postings[i - 1].term)
+                && index_.Find(postings[i].term) == nullptr) {
+            empty_terms.push_back(postings[i].term);
+        }
+    }
+
+    size_t text_size = 0;
+    for (const int document_id : document_ids) {
+        text_size += documents_.at(document_id).content.size();
+        document_to_word_freqs_.erase(document_id);
+        documents_.erase(document_id);
+        documents_id_.erase(document_id);
+    }
+    if (index_.RemoveEmptyTerms(empty_terms)) {
+        RebindWordFrequencies();
+    }
+    index_.SetDocumentCount(documents_.size());
+    ReleaseDocumentText(text_size);
+    epoch_.Advance();
+}
+
+template <typename ExecutionPolicy, typename TermAction>
+void SearchServer::ForEachTermPostings(ExecutionPolicy&& policy,
+                                       std::vector<InvertedIndex::Posting>& postings,
+                                       TermAction action)
+{
+    Sort(policy, postings.begin(), postings.end(),
+         [](const InvertedIndex::Posting& lhs, const InvertedIndex::Posting& rhs) {
+             return lhs.term < rhs.term
+                     || (lhs.term == rhs.term && lhs.document_id < rhs.document_id);
+         });
+
+    std::vector<size_t> term_starts;
+    for (size_t i = 0; i < postings.size(); ++i) {
+        if (i == 0 || postings[i].term != postings[i - 1].term) {
+            term_starts.push_back(i);
+        }
+    }
+    ForEach(policy, term_starts.begin(), term_starts.end(),
+            [&postings, &term_starts, &action](const size_t& start) {
+        const size_t next = static_cast<size_t>(&start - term_starts.data()) + 1;
+        const size_t end = next < term_starts.size() ? term_starts[next] : postings.size();
+        action(postings.cbegin() + static_cast<ptrdiff_t>(start),
+               postings.cbegin() + static_cast<ptrdiff_t>(end));
+    });
 }
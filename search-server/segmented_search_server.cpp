@@ -0,0 +1,277 @@
+#include "segmented_search_server.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+SegmentedSearchServer::Segment::Segment(SearchServer&& segment_server, size_t segment_level)
+    : server{std::move(segment_server)},
+      level{segment_level},
+      document_ids(server.begin(), server.end()),
+      removed(document_ids.size(), false)
+{
+}
+
+size_t SegmentedSearchServer::Segment::FindDocument(int document_id) const
+{
+    const auto it = std::lower_bound(document_ids.begin(), document_ids.end(), document_id);
+    return it != document_ids.end() && *it == document_id
+            ? static_cast<size_t>(it - document_ids.begin())
+            : document_ids.size();
+}
+
+bool SegmentedSearchServer::Segment::IsRemoved(int document_id) const
+{
+    if (removed_count == 0) return false;
+    const size_t position = FindDocument(document_id);
+    return position == document_ids.size() || removed[position];
+}
+
+void SegmentedSearchServer::Segment::MarkRemoved(size_t position)
+{
+    removed[position] = true;
+    ++removed_count;
+}
+
+SegmentedSearchServer::~SegmentedSearchServer()
+{
+    {
+        std::lock_guard guard(merge_mutex_);
+        stopping_ = true;
+    }
+    merge_condition_.notify_all();
+    merge_thread_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id,
+                                        const std::string_view document,
+                                        DocumentStatus status,
+                                        const std::vector<int>& ratings)
+{
+    bool sealed = false;
+    {
+        std::unique_lock lock(mutex_);
+        // memtable знает только свои документы
+        if (document_ids_.count(document_id) > 0) {
+            throw std::invalid_argument("Документ с id уже добавлен");
+        }
+        memtable_.AddDocument(document_id, document, status, ratings);
+        document_ids_.insert(document_id);
+
+        if (static_cast<size_t>(memtable_.GetDocumentCount()) >= memtable_size_) {
+            SealMemtable();
+            sealed = true;
+        }
+    }
+    if (sealed) {
+        RequestMerge();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id)
+{
+    std::unique_lock lock(mutex_);
+    if (document_ids_.count(document_id) == 0) {
+        throw std::out_of_range("No document");
+    }
+    document_ids_.erase(document_id);
+
+    if (memtable_.documents_.count(document_id) > 0) {
+        memtable_.RemoveDocument(document_id);
+        return;
+    }
+    for (const auto& segment : segments_) {
+        const size_t position = segment->FindDocument(document_id);
+        if (position != segment->document_ids.size() && !segment->removed[position]) {
+            RemoveFromSegment(*segment, position);
+            return;
+        }
+    }
+}
+
+std::vector<Document>
+SegmentedSearchServer::FindTopDocuments(const std::string_view raw_query,
+                                        DocumentStatus status,
+                                        size_t result_count) const
+{
+    return FindTopDocuments(std::execution::seq, raw_query, status, result_count);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const
+{
+    std::shared_lock lock(mutex_);
+    return static_cast<int>(document_ids_.size());
+}
+
+SegmentedSearchServer::MatchedDocument
+SegmentedSearchServer::MatchDocument(const std::string_view raw_query, int document_id) const
+{
+    std::shared_lock lock(mutex_);
+    const SearchServer* server = &memtable_;
+    for (const auto& segment : segments_) {
+        const size_t position = segment->FindDocument(document_id);
+        if (position != segment->document_ids.size() && !segment->removed[position]) {
+            server = &segment->server;
+            break;
+        }
+    }
+
+    const auto [words, status] = server->MatchDocument(raw_query, document_id);
+    return {std::vector<std::string>(words.begin(), words.end()), status};
+}
+
+std::map<std::string, double> SegmentedSearchServer::GetWordFrequencies(int document_id) const
+{
+    std::shared_lock lock(mutex_);
+    const SearchServer* server = &memtable_;
+    for (const auto& segment : segments_) {
+        const size_t position = segment->FindDocument(document_id);
+        if (position != segment->document_ids.size() && !segment->removed[position]) {
+            server = &segment->server;
+            break;
+        }
+    }
+
+    const auto& word_frequencies = server->GetWordFrequencies(document_id);
+    return {word_frequencies.begin(), word_frequencies.end()};
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const
+{
+    std::shared_lock lock(mutex_);
+    return segments_.size();
+}
+
+void SegmentedSearchServer::WaitForMerges()
+{
+    std::unique_lock lock(merge_mutex_);
+    merge_condition_.wait(lock, [this] { return !merge_requested_ && !merging_; });
+}
+
+SearchServer SegmentedSearchServer::CreateServer() const
+{
+    return SearchServer{stop_words_, posting_format_};
+}
+
+void SegmentedSearchServer::SealMemtable()
+{
+    segments_.push_back(std::make_shared<Segment>(std::move(memtable_), 0));
+    memtable_ = CreateServer();
+}
+
+void SegmentedSearchServer::RemoveFromSegment(Segment& segment, size_t position)
+{
+    segment.MarkRemoved(position);
+    for (const auto& [word, frequency] : segment.server.GetWordFrequencies(segment.document_ids[position])) {
+        const auto it = removed_document_freqs_.find(word);
+        if (it == removed_document_freqs_.end()) {
+            removed_document_freqs_.emplace(word, 1);
+        } else {
+            ++it->second;
+        }
+    }
+}
+
+std::vector<std::shared_ptr<SegmentedSearchServer::Segment>>
+SegmentedSearchServer::SelectMergeInputs() const
+{
+    // Сливаются самые старые сегменты самого нижнего переполненного уровня,
+    // поэтому сегменты сначала раскладываются по уровням целиком
+    std::map<size_t, std::vector<std::shared_ptr<Segment>>> levels;
+    for (const auto& segment : segments_) {
+        levels[segment->level].push_back(segment);
+    }
+    for (auto& [level, segments] : levels) {
+        if (segments.size() >= MERGE_FACTOR) {
+            segments.resize(MERGE_FACTOR);
+            return segments;
+        }
+    }
+    return {};
+}
+
+void SegmentedSearchServer::RequestMerge()
+{
+    {
+        std::lock_guard guard(merge_mutex_);
+        merge_requested_ = true;
+    }
+    merge_condition_.notify_all();
+}
+
+void SegmentedSearchServer::RunMerges()
+{
+    std::unique_lock lock(merge_mutex_);
+    while (true) {
+        merge_condition_.wait(lock, [this] { return stopping_ || merge_requested_; });
+        if (stopping_) return;
+        merge_requested_ = false;
+        merging_ = true;
+        lock.unlock();
+
+        while (true) {
+            std::vector<std::shared_ptr<Segment>> inputs;
+            {
+                std::shared_lock state_lock(mutex_);
+                inputs = SelectMergeInputs();
+            }
+            if (inputs.empty()) break;
+            Merge(inputs);
+        }
+
+        lock.lock();
+        merging_ = false;
+        merge_condition_.notify_all();
+    }
+}
+
+void SegmentedSearchServer::Merge(const std::vector<std::shared_ptr<Segment>>& inputs)
+{
+    // Сегменты неизменяемы, меняются только их отметки об удалении,
+    // поэтому документы читаются под разделяемой блокировкой,
+    // а новый сегмент строится вообще без неё
+    std::vector<std::vector<bool>> removed_before;
+    std::vector<RawDocument> documents;
+    {
+        std::shared_lock lock(mutex_);
+        for (const auto& input : inputs) {
+            removed_before.push_back(input->removed);
+            for (size_t position = 0; position < input->document_ids.size(); ++position) {
+                if (input->removed[position]) continue;
+                const int document_id = input->document_ids[position];
+                const auto& document = input->server.documents_.at(document_id);
+                documents.push_back({document_id, document.content, document.status,
+                                     {document.rating}});
+            }
+        }
+    }
+
+    SearchServer server = CreateServer();
+    server.AddDocuments(std::execution::par, documents);
+    auto merged = std::make_shared<Segment>(std::move(server), inputs.front()->level + 1);
+
+    std::unique_lock lock(mutex_);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        const Segment& input = *inputs[i];
+        for (size_t position = 0; position < input.document_ids.size(); ++position) {
+            const int document_id = input.document_ids[position];
+            if (removed_before[i][position]) {
+                // Документ выброшен и больше не входит в частоты сегментов
+                for (const auto& [word, frequency] : input.server.GetWordFrequencies(document_id)) {
+                    const auto it = removed_document_freqs_.find(word);
+                    if (--it->second == 0) {
+                        removed_document_freqs_.erase(it);
+                    }
+                }
+            } else if (input.removed[position]) {
+                // Удалён во время слияния: остаётся в новом сегменте с отметкой
+                merged->MarkRemoved(merged->FindDocument(document_id));
+            }
+        }
+    }
+
+    segments_.erase(std::remove_if(segments_.begin(), segments_.end(),
+                                   [&inputs](const std::shared_ptr<Segment>& segment) {
+        return std::find(inputs.begin(), inputs.end(), segment) != inputs.end();
+    }), segments_.end());
+    segments_.push_back(std::move(merged));
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Индекс из неизменяемых сегментов в духе LSM-дерева. Новые документы попадают
+// в небольшой изменяемый SearchServer (memtable), который по заполнении
+// замораживается и становится сегментом. Удалённый из сегмента документ только
+// отмечается в битовой карте. Фоновый поток сливает MERGE_FACTOR сегментов
+// одного уровня в сегмент следующего уровня, выбрасывая удалённые документы.
+// IDF считается по всем сегментам без учёта удалённых документов, поэтому
+// результаты поиска те же, что у одного SearchServer.
+// Методы можно вызывать одновременно из нескольких потоков.
+class SegmentedSearchServer {
+public:
+    static constexpr size_t DEFAULT_MEMTABLE_SIZE = 1024;
+    static constexpr size_t MERGE_FACTOR = 4;
+
+    // Стоп-слова задаются так же, как для SearchServer
+    template <typename StopWordCollection>
+    explicit SegmentedSearchServer(const StopWordCollection& stop_words,
+                                   size_t memtable_size = DEFAULT_MEMTABLE_SIZE,
+                                   PostingFormat posting_format = PostingFormat::PLAIN);
+    ~SegmentedSearchServer();
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+    void AddDocument(int document_id, const std::string_view document,
+                     DocumentStatus status, const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    template<typename Predicate, typename ExecutionPolicy>
+    std::vector<Document>
+    FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query,
+                     Predicate predicate,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template<typename Predicate>
+    std::vector<Document>
+    FindTopDocuments(const std::string_view raw_query, Predicate predicate,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template<typename ExecutionPolicy>
+    std::vector<Document>
+    FindTopDocuments(ExecutionPolicy&& policy,
+                     const std::string_view raw_query,
+                     DocumentStatus status = DocumentStatus::ACTUAL,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document>
+    FindTopDocuments(const std::string_view raw_query,
+                     DocumentStatus status = DocumentStatus::ACTUAL,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    int GetDocumentCount() const;
+
+    // Слова возвращаются копиями: сегмент с документом может быть
+    // заменён при слиянии в любой момент
+    using MatchedDocument = std::tuple<std::vector<std::string>, DocumentStatus>;
+    MatchedDocument MatchDocument(const std::string_view raw_query, int document_id) const;
+
+    std::map<std::string, double> GetWordFrequencies(int document_id) const;
+
+    // Число замороженных сегментов
+    size_t GetSegmentCount() const;
+    // Ждёт, пока будут выполнены все слияния, нужные при текущем наборе сегментов
+    void WaitForMerges();
+
+private:
+    struct Segment {
+        SearchServer server;
+        size_t level;
+        // id документов по возрастанию и отметки об удалении с теми же индексами
+        std::vector<int> document_ids;
+        std::vector<bool> removed;
+        size_t removed_count = 0;
+
+        Segment(SearchServer&& segment_server, size_t segment_level);
+
+        // Индекс документа в document_ids или document_ids.size(), если его нет
+        size_t FindDocument(int document_id) const;
+        bool IsRemoved(int document_id) const;
+        void MarkRemoved(size_t position);
+    };
+
+    std::vector<std::string> stop_words_{};
+    size_t memtable_size_;
+    PostingFormat posting_format_;
+
+    // Защищает всё, кроме состояния слияний
+    mutable std::shared_mutex mutex_{};
+    SearchServer memtable_;
+    std::vector<std::shared_ptr<Segment>> segments_{};
+    std::set<int> document_ids_{};
+    // Сколько отмеченных удалёнными, но ещё не выброшенных документов содержат слово
+    std::map<std::string, int64_t, std::less<>> removed_document_freqs_{};
+
+    std::mutex merge_mutex_{};
+    std::condition_variable merge_condition_{};
+    bool merge_requested_ = false;
+    bool merging_ = false;
+    bool stopping_ = false;
+    std::thread merge_thread_{};
+
+    SearchServer CreateServer() const;
+
+    // Следующие функции вызываются под исключительной блокировкой mutex_
+    void SealMemtable();
+    void RemoveFromSegment(Segment& segment, size_t position);
+
+    // Сегменты для следующего слияния или пустой набор, если сливать нечего.
+    // Вызывается под блокировкой mutex_
+    std::vector<std::shared_ptr<Segment>> SelectMergeInputs() const;
+    void RequestMerge();
+    void RunMerges();
+    void Merge(const std::vector<std::shared_ptr<Segment>>& inputs);
+};
+
+template <typename StopWordCollection>
+SegmentedSearchServer::SegmentedSearchServer(const StopWordCollection& stop_words,
+                                             size_t memtable_size,
+                                             PostingFormat posting_format)
+    : memtable_size_{memtable_size},
+      posting_format_{posting_format},
+      memtable_{stop_words, posting_format}
+{
+    for (const std::string_view word : memtable_.stop_words_.GetSortedWords()) {
+        stop_words_.emplace_back(word);
+    }
+    merge_thread_ = std::thread(&SegmentedSearchServer::RunMerges, this);
+}
+
+template<typename Predicate, typename ExecutionPolicy>
+std::vector<Document>
+SegmentedSearchServer::FindTopDocuments(ExecutionPolicy&& policy,
+                                        const std::string_view raw_query,
+                                        Predicate predicate,
+                                        size_t result_count) const
+{
+    std::shared_lock lock(mutex_);
+
+    SearchServer::DocumentFreqs document_freqs;
+    memtable_.CollectDocumentFreqs(raw_query, document_freqs);
+    for (const auto& segment : segments_) {
+        segment->server.CollectDocumentFreqs(raw_query, document_freqs);
+    }
+    // Удалённые документы ещё лежат в сегментах, но в IDF учитываться не должны
+    std::vector<std::string_view> words;
+    for (const auto& [word, document_freq] : document_freqs) {
+        words.push_back(word);
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    for (const std::string_view word : words) {
+        if (const auto it = removed_document_freqs_.find(word); it != removed_document_freqs_.end()) {
+            document_freqs.emplace_back(word, -it->second);
+        }
+    }
+    const SearchServer::InverseDocumentFreqs inverse_document_freqs =
+            SearchServer::CombineDocumentFreqs(std::move(document_freqs), document_ids_.size());
+
+    // Источник 0 - memtable, остальные - сегменты
+    std::vector<size_t> sources(segments_.size() + 1);
+    std::iota(sources.begin(), sources.end(), 0);
+    std::vector<std::vector<Document>> source_documents(sources.size());
+    ForEach(policy, sources.begin(), sources.end(), [&](size_t source) {
+        const Segment* segment = source == 0 ? nullptr : segments_[source - 1].get();
+        const SearchServer& server = segment == nullptr ? memtable_ : segment->server;
+        const auto live_predicate = [segment, &predicate](int document_id,
+                                                          DocumentStatus status,
+                                                          int rating) {
+            return (segment == nullptr || !segment->IsRemoved(document_id))
+                    && predicate(document_id, status, rating);
+        };
+        source_documents[source] =
+                server.FindTopDocuments(std::execution::seq, SearchServer::GetThreadQueryContext(),
+                                        raw_query, live_predicate, result_count,
+                                        SearchServer::GlobalInverseDocumentFreq{
+                                            server.index_, inverse_document_freqs});
+    });
+
+    std::vector<Document> documents;
+    for (const auto& found : source_documents) {
+        documents.insert(documents.end(), found.begin(), found.end());
+    }
+    std::vector<Document> candidates;
+    SearchServer::SelectTopDocuments(std::execution::seq, documents, candidates, result_count);
+    return documents;
+}
+
+template<typename Predicate>
+std::vector<Document>
+SegmentedSearchServer::FindTopDocuments(const std::string_view raw_query,
+                                        Predicate predicate,
+                                        size_t result_count) const
+{
+    return FindTopDocuments(std::execution::seq, raw_query, predicate, result_count);
+}
+
+template<typename ExecutionPolicy>
+std::vector<Document>
+SegmentedSearchServer::FindTopDocuments(ExecutionPolicy&& policy,
+                                        const std::string_view raw_query,
+                                        DocumentStatus status,
+                                        size_t result_count) const
+{
+    const auto predicate = [status]([[maybe_unused]] int document_id,
+                                    DocumentStatus s,
+                                    [[maybe_unused]] int rating)
+                                    {
+                                        return s == status;
+                                    };
+    return FindTopDocuments(policy, raw_query, predicate, result_count);
+}
@@ -0,0 +1,64 @@
+#include "sharded_search_server.h"
+
+#include <string>
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count)
+    : ShardedSearchServer{std::vector<std::string>{}, shard_count}
+{
+}
+
+void ShardedSearchServer::AddDocument(int document_id,
+                                      const std::string_view document,
+                                      DocumentStatus status,
+                                      const std::vector<int>& ratings)
+{
+    if (document_id < 0) {
+        throw std::invalid_argument("Документ с отрицательным id");
+    }
+    shards_[GetShardIndex(document_id)].AddDocument(document_id, document, status, ratings);
+}
+
+std::vector<Document>
+ShardedSearchServer::FindTopDocuments(const std::string_view raw_query,
+                                      DocumentStatus status,
+                                      size_t result_count) const
+{
+    return FindTopDocuments(std::execution::seq, raw_query, status, result_count);
+}
+
+int ShardedSearchServer::GetDocumentCount() const
+{
+    int document_count = 0;
+    for (const SearchServer& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const
+{
+    return shards_.size();
+}
+
+SearchServer::MatchedDocument
+ShardedSearchServer::MatchDocument(const std::string_view raw_query, int document_id) const
+{
+    return shards_[GetShardIndex(document_id)].MatchDocument(raw_query, document_id);
+}
+
+const std::map<std::string_view, double>&
+ShardedSearchServer::GetWordFrequencies(int document_id) const
+{
+    return shards_[GetShardIndex(document_id)].GetWordFrequencies(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id)
+{
+    shards_[GetShardIndex(document_id)].RemoveDocument(document_id);
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const
+{
+    // Документов с отрицательным id нет ни в одном шарде
+    return document_id < 0 ? 0 : static_cast<size_t>(document_id) % shards_.size();
+}
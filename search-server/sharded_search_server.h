@@ -0,0 +1,196 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <execution>
+#include <map>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Индекс, разделённый по id документов между несколькими SearchServer:
+// документ с id попадает в шард id % GetShardCount(). Документы добавляются
+// в шарды и ищутся в них параллельно, после чего лучшие документы шардов
+// сливаются. IDF слов запроса считается по всем шардам сразу, поэтому
+// релевантность та же, что и у одного SearchServer со всеми документами.
+class ShardedSearchServer {
+public:
+    // shard_count == 0 - по одному шарду на ядро
+    explicit ShardedSearchServer(size_t shard_count = 0);
+
+    // Стоп-слова задаются так же, как для SearchServer. Числа не считаются
+    // стоп-словами, чтобы ShardedSearchServer(4) выбирал конструктор выше
+    template <typename StopWordCollection,
+              typename = std::enable_if_t<!std::is_arithmetic_v<StopWordCollection>>>
+    explicit ShardedSearchServer(const StopWordCollection& stop_words, size_t shard_count = 0,
+                                 PostingFormat posting_format = PostingFormat::PLAIN);
+
+    void AddDocument(int document_id, const std::string_view document,
+                     DocumentStatus status, const std::vector<int>& ratings);
+
+    // Шарды принимают свои части пакета параллельно. Если хотя бы один
+    // документ некорректен, не добавляется ни один.
+    template <typename ExecutionPolicy, typename DocumentRange>
+    void AddDocuments(ExecutionPolicy&& policy, const DocumentRange& documents);
+
+    template <typename DocumentRange>
+    void AddDocuments(const DocumentRange& documents);
+
+    template<typename Predicate, typename ExecutionPolicy>
+    std::vector<Document>
+    FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query,
+                     Predicate predicate,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template<typename Predicate>
+    std::vector<Document>
+    FindTopDocuments(const std::string_view raw_query, Predicate predicate,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template<typename ExecutionPolicy>
+    std::vector<Document>
+    FindTopDocuments(ExecutionPolicy&& policy,
+                     const std::string_view raw_query,
+                     DocumentStatus status = DocumentStatus::ACTUAL,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document>
+    FindTopDocuments(const std::string_view raw_query,
+                     DocumentStatus status = DocumentStatus::ACTUAL,
+                     size_t result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    int GetDocumentCount() const;
+    size_t GetShardCount() const;
+
+    SearchServer::MatchedDocument MatchDocument(const std::string_view raw_query,
+                                                int document_id) const;
+
+    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+
+    void RemoveDocument(int document_id);
+
+private:
+    std::vector<SearchServer> shards_{};
+
+    size_t GetShardIndex(int document_id) const;
+};
+
+template <typename StopWordCollection, typename>
+ShardedSearchServer::ShardedSearchServer(const StopWordCollection& stop_words,
+                                         size_t shard_count,
+                                         PostingFormat posting_format)
+{
+    const size_t count = shard_count == 0 ? SearchServer::GetShardCount() : shard_count;
+    shards_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        shards_.emplace_back(stop_words, posting_format);
+    }
+}
+
+template <typename ExecutionPolicy, typename DocumentRange>
+void ShardedSearchServer::AddDocuments(ExecutionPolicy&& policy, const DocumentRange& documents)
+{
+    std::vector<std::vector<RawDocument>> shard_documents(shards_.size());
+    for (const RawDocument& document : documents) {
+        if (document.id < 0) {
+            throw std::invalid_argument("Документ с отрицательным id");
+        }
+        shard_documents[GetShardIndex(document.id)].push_back(document);
+    }
+
+    std::vector<std::exception_ptr> errors(shards_.size());
+    ForEach(policy, shards_.begin(), shards_.end(),
+            [this, &shard_documents, &errors](SearchServer& shard) {
+        const auto index = static_cast<size_t>(&shard - shards_.data());
+        try {
+            shard.AddDocuments(std::execution::seq, shard_documents[index]);
+        } catch (...) {
+            errors[index] = std::current_exception();
+        }
+    });
+
+    // Шард, отклонивший свою часть, ничего не добавил,
+    // а части, принятые остальными шардами, удаляются
+    const auto error = std::find_if(errors.begin(), errors.end(),
+                                    [](const std::exception_ptr& e) { return e != nullptr; });
+    if (error == errors.end()) return;
+
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (errors[i]) continue;
+        for (const RawDocument& document : shard_documents[i]) {
+            shards_[i].RemoveDocument(document.id);
+        }
+    }
+    std::rethrow_exception(*error);
+}
+
+template <typename DocumentRange>
+void ShardedSearchServer::AddDocuments(const DocumentRange& documents)
+{
+    AddDocuments(std::execution::seq, documents);
+}
+
+template<typename Predicate, typename ExecutionPolicy>
+std::vector<Document>
+ShardedSearchServer::FindTopDocuments(ExecutionPolicy&& policy,
+                                      const std::string_view raw_query,
+                                      Predicate predicate,
+                                      size_t result_count) const
+{
+    SearchServer::DocumentFreqs document_freqs;
+    for (const SearchServer& shard : shards_) {
+        shard.CollectDocumentFreqs(raw_query, document_freqs);
+    }
+    const SearchServer::InverseDocumentFreqs inverse_document_freqs =
+            SearchServer::CombineDocumentFreqs(std::move(document_freqs),
+                                               static_cast<size_t>(GetDocumentCount()));
+
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    ForEach(policy, shards_.begin(), shards_.end(),
+            [&](const SearchServer& shard) {
+        shard_documents[static_cast<size_t>(&shard - shards_.data())] =
+                shard.FindTopDocuments(std::execution::seq, SearchServer::GetThreadQueryContext(),
+                                       raw_query, predicate, result_count,
+                                       SearchServer::GlobalInverseDocumentFreq{
+                                           shard.index_, inverse_document_freqs});
+    });
+
+    std::vector<Document> documents;
+    for (const auto& found : shard_documents) {
+        documents.insert(documents.end(), found.begin(), found.end());
+    }
+    std::vector<Document> candidates;
+    SearchServer::SelectTopDocuments(std::execution::seq, documents, candidates, result_count);
+    return documents;
+}
+
+template<typename Predicate>
+std::vector<Document>
+ShardedSearchServer::FindTopDocuments(const std::string_view raw_query,
+                                      Predicate predicate,
+                                      size_t result_count) const
+{
+    return FindTopDocuments(std::execution::seq, raw_query, predicate, result_count);
+}
+
+template<typename ExecutionPolicy>
+std::vector<Document>
+ShardedSearchServer::FindTopDocuments(ExecutionPolicy&& policy,
+                                      const std::string_view raw_query,
+                                      DocumentStatus status,
+                                      size_t result_count) const
+{
+    const auto predicate = [status]([[maybe_unused]] int document_id,
+                                    DocumentStatus s,
+                                    [[maybe_unused]] int rating)
+                                    {
+                                        return s == status;
+                                    };
+    return FindTopDocuments(policy, raw_query, predicate, result_count);
+}
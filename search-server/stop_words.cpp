@@ -0,0 +1,59 @@
+#include "stop_words.h"
+
+#include <algorithm>
+#include <utility>
+
+StopWords::StopWords(std::vector<std::string> words)
+    : words_{std::move(words)}
+{
+    std::sort(words_.begin(), words_.end());
+    words_.erase(std::unique(words_.begin(), words_.end()), words_.end());
+    if (!words_.empty() && words_.front().empty()) {
+        words_.erase(words_.begin());
+    }
+
+    // Из слов с равными хешами в таблицу попадает только первое
+    std::vector<std::pair<uint64_t, size_t>> hashed_words;
+    for (size_t i = 0; i < words_.size(); ++i) {
+        hashed_words.emplace_back(perfect_hash::Hash(words_[i]), i);
+    }
+    std::sort(hashed_words.begin(), hashed_words.end());
+    std::vector<std::string> table_words;
+    for (size_t i = 0; i < hashed_words.size(); ++i) {
+        const auto [hash, index] = hashed_words[i];
+        if (i > 0 && hashed_words[i - 1].first == hash) {
+            colliding_words_.push_back(std::move(words_[index]));
+        } else {
+            table_words.push_back(std::move(words_[index]));
+            hashes_.push_back(hash);
+        }
+    }
+    words_ = std::move(table_words);
+
+    const size_t table_size = perfect_hash::GetTableSize(words_.size());
+    seeds_.resize(table_size);
+    slots_.resize(table_size);
+    std::vector<uint32_t> bucket_sizes(table_size);
+    perfect_hash::Build(hashes_, hashes_.size(), seeds_, slots_, bucket_sizes, table_size);
+}
+
+bool StopWords::Contains(const std::string_view word) const
+{
+    const uint64_t hash = perfect_hash::Hash(word);
+    const uint32_t seed = seeds_[perfect_hash::GetBucket(hash, seeds_.size())];
+    const uint32_t index = slots_[perfect_hash::GetSlot(hash, seed, slots_.size())];
+    if (index != perfect_hash::EMPTY_SLOT && hashes_[index] == hash && words_[index] == word) {
+        return true;
+    }
+    return !colliding_words_.empty()
+            && std::find(colliding_words_.begin(), colliding_words_.end(), word)
+               != colliding_words_.end();
+}
+
+std::vector<std::string_view> StopWords::GetSortedWords() const
+{
+    std::vector<std::string_view> words(words_.begin(), words_.end());
+    words.insert(words.end(), colliding_words_.begin(), colliding_words_.end());
+    std::sort(words.begin(), words.end());
+    return words;
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Идеальное хеширование методом hash and displace: слово попадает в корзину
+// по своему хешу, а для каждой корзины подбирается смещение, при котором
+// слова всех корзин занимают разные ячейки таблицы. Поиск слова - один хеш
+// и одно сравнение строк. Построение пригодно и для constexpr-вычислений.
+namespace perfect_hash {
+
+constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+constexpr uint64_t Mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+constexpr uint64_t Hash(const std::string_view word)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char c : word) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return Mix(hash);
+}
+
+// Размер таблицы - степень двойки, не меньше удвоенного числа слов
+constexpr size_t GetTableSize(size_t word_count)
+{
+    size_t size = 1;
+    while (size < 2 * word_count) {
+        size *= 2;
+    }
+    return size;
+}
+
+constexpr size_t GetSlot(uint64_t hash, uint32_t seed, size_t table_size)
+{
+    return static_cast<size_t>(Mix(hash ^ (seed * 0x9e3779b97f4a7c15ULL))) & (table_size - 1);
+}
+
+constexpr size_t GetBucket(uint64_t hash, size_t table_size)
+{
+    return static_cast<size_t>(hash) & (table_size - 1);
+}
+
+// Пытается разместить слова корзины bucket со смещением seed
+template <typename Hashes, typename Table>
+constexpr bool PlaceBucket(const Hashes& hashes, size_t word_count,
+                           size_t bucket, uint32_t seed, Table& slots, size_t table_size)
+{
+    auto is_placed = [&](size_t i) {
+        return GetBucket(hashes[i], table_size) == bucket;
+    };
+
+    for (size_t i = 0; i < word_count; ++i) {
+        if (!is_placed(i)) continue;
+
+        const size_t slot = GetSlot(hashes[i], seed, table_size);
+        if (slots[slot] == EMPTY_SLOT) {
+            slots[slot] = static_cast<uint32_t>(i);
+            continue;
+        }
+        // Равные хеши попадают в один слот при любом seed
+        if (hashes[slots[slot]] == hashes[i]) {
+            throw std::invalid_argument("Стоп-слова с одинаковым хешем");
+        }
+        for (size_t j = 0; j < i; ++j) {
+            if (is_placed(j)) {
+                slots[GetSlot(hashes[j], seed, table_size)] = EMPTY_SLOT;
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+// Заполняет seeds и slots размера table_size по хешам различных слов.
+// Если хеши двух слов равны, выбрасывает invalid_argument.
+// Корзины размещаются от больших к маленьким: крупные корзины проще
+// разместить, пока таблица пуста. bucket_sizes - буфер того же размера.
+template <typename Hashes, typename Table>
+constexpr void Build(const Hashes& hashes, size_t word_count,
+                     Table& seeds, Table& slots, Table& bucket_sizes, size_t table_size)
+{
+    uint32_t max_bucket_size = 0;
+    for (size_t i = 0; i < table_size; ++i) {
+        seeds[i] = 0;
+        slots[i] = EMPTY_SLOT;
+        bucket_sizes[i] = 0;
+    }
+    for (size_t i = 0; i < word_count; ++i) {
+        uint32_t& size = bucket_sizes[GetBucket(hashes[i], table_size)];
+        ++size;
+        max_bucket_size = size > max_bucket_size ? size : max_bucket_size;
+    }
+
+    for (uint32_t size = max_bucket_size; size > 0; --size) {
+        for (size_t bucket = 0; bucket < table_size; ++bucket) {
+            if (bucket_sizes[bucket] != size) continue;
+
+            uint32_t seed = 1;
+            while (!PlaceBucket(hashes, word_count, bucket, seed, slots, table_size)) {
+                ++seed;
+            }
+            seeds[bucket] = seed;
+        }
+    }
+}
+
+} // namespace perfect_hash
+
+// Стоп-слова, известные при компиляции. Таблица строится constexpr-конструктором:
+//     constexpr StaticStopWords stop_words {std::array{"и"sv, "в"sv, "на"sv}};
+// Слова должны быть непустыми и различными, с различными хешами, иначе
+// конструктор выбрасывает исключение (при constexpr-вычислении это ошибка компиляции).
+// Строки должны жить дольше объекта (обычно это строковые литералы).
+template <size_t N>
+class StaticStopWords {
+public:
+    static constexpr size_t TABLE_SIZE = perfect_hash::GetTableSize(N);
+
+    constexpr explicit StaticStopWords(const std::array<std::string_view, N>& words)
+        : words_{words}
+    {
+        std::array<uint64_t, N> hashes {};
+        for (size_t i = 0; i < N; ++i) {
+            if (words_[i].empty()) {
+                throw std::invalid_argument("Пустое стоп-слово");
+            }
+            for (size_t j = 0; j < i; ++j) {
+                if (words_[j] == words_[i]) {
+                    throw std::invalid_argument("Повторяющееся стоп-слово");
+                }
+            }
+            hashes[i] = perfect_hash::Hash(words_[i]);
+        }
+        std::array<uint32_t, TABLE_SIZE> bucket_sizes {};
+        perfect_hash::Build(hashes, N, seeds_, slots_, bucket_sizes, TABLE_SIZE);
+    }
+
+    constexpr bool Contains(const std::string_view word) const
+    {
+        const uint64_t hash = perfect_hash::Hash(word);
+        const uint32_t seed = seeds_[perfect_hash::GetBucket(hash, TABLE_SIZE)];
+        const uint32_t index = slots_[perfect_hash::GetSlot(hash, seed, TABLE_SIZE)];
+        return index != perfect_hash::EMPTY_SLOT && words_[index] == word;
+    }
+
+    constexpr const std::array<std::string_view, N>& GetWords() const { return words_; }
+    constexpr const std::array<uint32_t, TABLE_SIZE>& GetSeeds() const { return seeds_; }
+    constexpr const std::array<uint32_t, TABLE_SIZE>& GetSlots() const { return slots_; }
+
+private:
+    std::array<std::string_view, N> words_;
+    std::array<uint32_t, TABLE_SIZE> seeds_ {};
+    std::array<uint32_t, TABLE_SIZE> slots_ {};
+};
+
+// Стоп-слова, заданные при создании SearchServer. Набор не меняется,
+// поэтому таблица с идеальным хешированием строится один раз.
+class StopWords {
+public:
+    StopWords() = default;
+    // Пустые слова и повторы отбрасываются
+    explicit StopWords(std::vector<std::string> words);
+
+    // Берёт готовую таблицу, построенную при компиляции
+    template <size_t N>
+    explicit StopWords(const StaticStopWords<N>& words);
+
+    bool Contains(const std::string_view word) const;
+
+    // Слова без повторов в порядке возрастания
+    std::vector<std::string_view> GetSortedWords() const;
+
+private:
+    std::vector<std::string> words_{};
+    std::vector<uint64_t> hashes_{};
+    std::vector<uint32_t> seeds_{0};
+    std::vector<uint32_t> slots_{perfect_hash::EMPTY_SLOT};
+    // Слова, хеш которых совпал с хешем слова из таблицы. Идеальный хеш для
+    // них не построить, поэтому они проверяются перебором
+    std::vector<std::string> colliding_words_{};
+};
+
+template <size_t N>
+StopWords::StopWords(const StaticStopWords<N>& words)
+    : words_(words.GetWords().begin(), words.GetWords().end()),
+      seeds_(words.GetSeeds().begin(), words.GetSeeds().end()),
+      slots_(words.GetSlots().begin(), words.GetSlots().end())
+{
+    hashes_.reserve(words_.size());
+    for (const std::string& word : words_) {
+        hashes_.push_back(perfect_hash::Hash(word));
+    }
+}
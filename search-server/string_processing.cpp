@@ -1,22 +1,89 @@
 #include "string_processing.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
 #include <vector>
 
-std::vector<std::string_view> SplitIntoWords(std::string_view text)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+bool IsControlCharacter(char c)
 {
-    text.remove_prefix(std::min(text.find_first_not_of(' '), text.size()));
-    if (text.empty()) return {};
+    return c >= '\0' && c < ' ';
+}
 
-    size_t pos{0};
-    std::vector<std::string_view> result;
-    while (!text.empty()) {
-        pos = text.find(' ');
-        result.emplace_back(pos == text.npos ? text.substr() : text.substr(0, pos));
-        pos = text.find_first_not_of(' ', pos);
-        text.remove_prefix(std::min(pos, text.size()));
+// Один проход по тексту: границы слов ищутся по маске пробелов, а управляющие
+// символы - по маске кодов 0-31. С SSE2 текст обрабатывается по 16 байт.
+template <bool Validate>
+bool SplitText(const std::string_view text, std::vector<std::string_view>& words)
+{
+    const char* const data = text.data();
+    const size_t size = text.size();
+    size_t word_start = size;
+    bool prev_space = true;
+    size_t pos = 0;
+
+#if defined(__SSE2__)
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i minus_one = _mm_set1_epi8(-1);
+    for (; pos + 16 <= size; pos += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        if constexpr (Validate) {
+            const __m128i control = _mm_and_si128(_mm_cmplt_epi8(chunk, spaces),
+                                                  _mm_cmpgt_epi8(chunk, minus_one));
+            if (_mm_movemask_epi8(control) != 0) return false;
+        }
+
+        const auto space_mask = static_cast<uint32_t>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, spaces)));
+        const uint32_t prev_space_mask = ((space_mask << 1) | (prev_space ? 1u : 0u)) & 0xFFFFu;
+        const uint32_t starts = ~space_mask & prev_space_mask & 0xFFFFu;
+        const uint32_t ends = space_mask & ~prev_space_mask & 0xFFFFu;
+        for (uint32_t boundaries = starts | ends; boundaries != 0; boundaries &= boundaries - 1) {
+            const auto bit = static_cast<size_t>(__builtin_ctz(boundaries));
+            if (starts & (1u << bit)) {
+                word_start = pos + bit;
+            } else {
+                words.emplace_back(data + word_start, pos + bit - word_start);
+            }
+        }
+        prev_space = (space_mask & 0x8000u) != 0;
     }
+#endif
 
+    for (; pos < size; ++pos) {
+        const char c = data[pos];
+        if constexpr (Validate) {
+            if (IsControlCharacter(c)) return false;
+        }
+        const bool is_space = c == ' ';
+        if (!is_space && prev_space) {
+            word_start = pos;
+        } else if (is_space && !prev_space) {
+            words.emplace_back(data + word_start, pos - word_start);
+        }
+        prev_space = is_space;
+    }
+    if (!prev_space) {
+        words.emplace_back(data + word_start, size - word_start);
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text)
+{
+    std::vector<std::string_view> result;
+    SplitText<false>(text, result);
     return result;
 }
+
+bool SplitIntoValidWords(const std::string_view text, std::vector<std::string_view>& words)
+{
+    return SplitText<true>(text, words);
+}
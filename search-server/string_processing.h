@@ -4,3 +4,9 @@
 #include <vector>
 
 std::vector<std::string_view> SplitIntoWords(const std::string_view text);
+
+// Разбивает text на слова по пробелам и дописывает их в words, заодно проверяя,
+// что в тексте нет управляющих символов (коды 0-31). Возвращает false, если такой
+// символ найден; содержимое words в этом случае не определено.
+// Буфер words можно переиспользовать между вызовами, чтобы не выделять память.
+bool SplitIntoValidWords(const std::string_view text, std::vector<std::string_view>& words);
@@ -1,9 +1,32 @@
 #include "test_example_functions.h"
+#include "concurrent_search_server.h"
 #include "document.h"
+#include "index_snapshot.h"
+#include "process_queries.h"
+#include "query_cache.h"
+#include "query_scheduler.h"
+#include "relevance_accumulator.h"
+#include "remove_duplicates.h"
+#include "request_queue.h"
 #include "search_server.h"
+#include "segmented_search_server.h"
+#include "sharded_search_server.h"
+#include "stop_words.h"
+#include "string_processing.h"
+#include "text_arena.h"
+#include "thread_pool.h"
 
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <set>
 #include <map>
 
@@ -138,6 +161,20 @@ void TestExcludeMinusQueryFromSearchServer()
         ASSERT_HINT(found_docs.empty(),
                     "Неправильная обработка запроса с минус-словами"s);
     }
+
+    {
+        SearchServer server;
+        server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, ratings);
+        server.AddDocument(2, "cat in the box"s, DocumentStatus::ACTUAL, ratings);
+        server.AddDocument(3, "cat on the roof"s, DocumentStatus::ACTUAL, ratings);
+        server.AddDocument(4, "dog on the roof"s, DocumentStatus::ACTUAL, ratings);
+        for (const auto& found_docs : {server.FindTopDocuments(std::execution::seq, "cat -city -box -dog"s),
+                                       server.FindTopDocuments(std::execution::par, "cat -city -box -dog"s)}) {
+            ASSERT_EQUAL_HINT(found_docs.size(), 1ul,
+                              "Документы с любым из минус-слов должны исключаться"s);
+            ASSERT_EQUAL(found_docs[0].id, 3);
+        }
+    }
 }
 
 void TestMatchedDocument()
@@ -165,6 +202,19 @@ void TestMatchedDocument()
                     "Должен возвращаться пустой список слов, "
                     "при наличии минус-слова в документе"s);
     }
+
+    {
+        SearchServer server;
+        server.AddDocument(document_id, content, DocumentStatus::ACTUAL, ratings);
+        const std::vector<std::string_view> query {"cat"sv, "city"sv, "the"sv};
+        const auto seq_words = server.MatchDocument(std::execution::seq,
+                                                    "the city dog cat city"s, document_id);
+        const auto par_words = server.MatchDocument(std::execution::par,
+                                                    "the city dog cat city"s, document_id);
+        ASSERT_EQUAL_HINT(std::get<0>(seq_words), query,
+                          "Слова должны возвращаться без повторов в порядке возрастания"s);
+        ASSERT_EQUAL(std::get<0>(par_words), query);
+    }
 }
 
 void TestSortedRelevance()
@@ -282,6 +332,23 @@ void TestCalcRelevance()
     ASSERT(std::abs(found_docs[0].relevance - RELEVANCE) < EPSILON);
 }
 
+void TestRelevanceAfterIndexUpdate()
+{
+    SearchServer server;
+    server.AddDocument(1, "кот"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "пёс"s, DocumentStatus::ACTUAL, {1});
+    ASSERT(std::abs(server.FindTopDocuments("кот"s)[0].relevance - std::log(2.0)) < EPSILON);
+
+    server.AddDocument(3, "кот пёс"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(4, "скворец"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_HINT(std::abs(server.FindTopDocuments("кот"s)[0].relevance - std::log(2.0)) < EPSILON,
+                "IDF должен учитывать добавленные документы"s);
+
+    server.RemoveDocument(4);
+    ASSERT_HINT(std::abs(server.FindTopDocuments("кот"s)[0].relevance - std::log(1.5)) < EPSILON,
+                "IDF должен учитывать удалённые документы"s);
+}
+
 void TestServerIterator()
 {
     SearchServer server("и в на"s);
@@ -318,6 +385,1250 @@ void TestRemoveDocument()
     ASSERT_EQUAL(server.GetWordFrequencies(50), expected);
 }
 
+void TestRemovedDocumentNotFound()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(100, "белый кот и модный ошейник"s,      DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(1, "пушистый кот пушистый хвост"s,       DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(50, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    server.RemoveDocument(1);
+
+    const auto found_docs = server.FindTopDocuments("пушистый кот"s);
+    ASSERT_EQUAL_HINT(found_docs.size(), 1ul, "Удалённый документ не должен находиться"s);
+    ASSERT_EQUAL(found_docs[0].id, 100);
+    ASSERT_HINT(std::get<0>(server.MatchDocument("пушистый"s, 50)).empty(),
+                "Слово удалённого документа не должно находиться в других документах"s);
+
+    server.AddDocument(1, "пушистый кот"s, DocumentStatus::ACTUAL, {1});
+    const auto found_again = server.FindTopDocuments("пушистый"s);
+    ASSERT_EQUAL_HINT(found_again.size(), 1ul, "Повторно добавленный документ должен находиться"s);
+    ASSERT_EQUAL(found_again[0].id, 1);
+}
+
+void TestParallelFindTopDocuments()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s,               DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(1, "пушистый кот пушистый хвост"s,              DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "ухоженный пёс выразительные глаза"s,        DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    server.AddDocument(1'000'000, "ухоженный скворец евгений"s,        DocumentStatus::ACTUAL, {9});
+    server.AddDocument(2'000'000'000, "пушистый скворец и белый хвост"s, DocumentStatus::ACTUAL, {1});
+
+    for (const std::string& query : {"пушистый ухоженный кот"s, "белый хвост -кот"s, "скворец"s}) {
+        const auto seq_docs = server.FindTopDocuments(std::execution::seq, query);
+        const auto par_docs = server.FindTopDocuments(std::execution::par, query);
+        ASSERT_EQUAL_HINT(seq_docs.size(), par_docs.size(),
+                          "Последовательный и параллельный поиск должны совпадать"s);
+        for (size_t i = 0; i < seq_docs.size(); ++i) {
+            ASSERT_EQUAL(seq_docs[i].id, par_docs[i].id);
+            ASSERT(std::abs(seq_docs[i].relevance - par_docs[i].relevance) < EPSILON);
+        }
+    }
+}
+
+void TestResultCount()
+{
+    SearchServer server;
+    for (int id = 0; id < 100; ++id) {
+        server.AddDocument(id, "кот "s + std::string(static_cast<size_t>(id % 7 + 1), 'a'),
+                           DocumentStatus::ACTUAL, {id});
+    }
+
+    ASSERT_EQUAL(server.FindTopDocuments("кот"s).size(), MAX_RESULT_DOCUMENT_COUNT);
+    ASSERT_EQUAL(server.FindTopDocuments("кот"s, DocumentStatus::ACTUAL, 20).size(), 20ul);
+    ASSERT_EQUAL(server.FindTopDocuments("кот"s, DocumentStatus::ACTUAL, 1000).size(), 100ul);
+
+    const auto seq_docs = server.FindTopDocuments(std::execution::seq, "кот a aaa"s,
+                                                  DocumentStatus::ACTUAL, 30);
+    const auto par_docs = server.FindTopDocuments(std::execution::par, "кот a aaa"s,
+                                                  DocumentStatus::ACTUAL, 30);
+    ASSERT_EQUAL(seq_docs.size(), 30ul);
+    ASSERT_EQUAL(par_docs.size(), 30ul);
+    for (size_t i = 0; i < seq_docs.size(); ++i) {
+        ASSERT_EQUAL_HINT(seq_docs[i].id, par_docs[i].id,
+                          "Параллельный отбор лучших документов должен совпадать с последовательным"s);
+    }
+    ASSERT_EQUAL(seq_docs[0].rating, 93);
+}
+
+void TestFindTopDocumentsWithPruning()
+{
+    const std::vector<std::string> words {"кот"s, "пёс"s, "хвост"s, "глаза"s, "ошейник"s,
+                                          "белый"s, "пушистый"s, "модный"s, "скворец"s};
+    SearchServer server;
+    for (int id = 0; id < 300; ++id) {
+        std::string text;
+        for (size_t i = 0; i < words.size(); ++i) {
+            if ((id * 7 + static_cast<int>(i) * 3) % (static_cast<int>(i) + 2) == 0) {
+                text += words[i] + ' ';
+            }
+        }
+        server.AddDocument(id, text + words[static_cast<size_t>(id) % words.size()],
+                           id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {id % 11});
+    }
+
+    for (const std::string& query : {"кот пёс хвост"s, "пушистый белый -кот скворец"s,
+                                     "глаза модный ошейник пёс -хвост"s, "слон"s}) {
+        for (size_t count : {1ul, 5ul, 50ul}) {
+            const auto exact = server.FindTopDocuments(query, DocumentStatus::ACTUAL, count);
+            const auto pruned = server.FindTopDocumentsWithPruning(query, DocumentStatus::ACTUAL, count);
+            ASSERT_EQUAL_HINT(exact.size(), pruned.size(),
+                              "Поиск с отсечением должен возвращать столько же документов"s);
+            for (size_t i = 0; i < exact.size(); ++i) {
+                ASSERT_HINT(std::abs(exact[i].relevance - pruned[i].relevance) < EPSILON,
+                            "Поиск с отсечением должен находить те же документы"s);
+                ASSERT_EQUAL(exact[i].rating, pruned[i].rating);
+            }
+        }
+    }
+}
+
+void TestTextArena()
+{
+    TextArena arena(16);
+    const std::string_view first = arena.Store("белый кот"sv);
+    const std::string_view empty = arena.Store(""sv);
+    std::vector<std::string_view> stored;
+    for (int i = 0; i < 100; ++i) {
+        stored.push_back(arena.Store(std::to_string(i)));
+    }
+    const std::string_view large = arena.Store(std::string(100, 'a'));
+
+    ASSERT_EQUAL(first, "белый кот"sv);
+    ASSERT(empty.empty());
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQUAL_HINT(stored[static_cast<size_t>(i)], std::string_view{std::to_string(i)},
+                          "Сохранённые строки не должны перемещаться"s);
+    }
+    ASSERT_EQUAL(large, std::string_view{std::string(100, 'a')});
+
+    const TextArena moved = std::move(arena);
+    ASSERT_EQUAL_HINT(first, "белый кот"sv, "Строки должны оставаться на месте после перемещения"s);
+    ASSERT(moved.GetChunkCount() < 100);
+}
+
+void TestTextCompaction()
+{
+    SearchServer server;
+    const std::string padding(1000, 'x');
+    for (int id = 0; id < 200; ++id) {
+        server.AddDocument(id, "кот "s + std::to_string(id) + ' ' + padding,
+                           DocumentStatus::ACTUAL, {id});
+    }
+    for (int id = 0; id < 200; ++id) {
+        if (id % 10 != 0) server.RemoveDocument(id);
+    }
+
+    ASSERT_EQUAL(server.GetDocumentCount(), 20);
+    const auto found_docs = server.FindTopDocuments("150"s);
+    ASSERT_EQUAL(found_docs.size(), 1ul);
+    ASSERT_EQUAL(found_docs[0].id, 150);
+    ASSERT_EQUAL(server.GetWordFrequencies(190).count("190"sv), 1ul);
+
+    server.AddDocument(1000, "пёс "s + padding, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(server.FindTopDocuments("пёс"s)[0].id, 1000);
+}
+
+void TestAddDocuments()
+{
+    const std::vector<std::string> texts {
+        "белый кот и модный ошейник"s,
+        "пушистый кот пушистый хвост"s,
+        "ухоженный пёс выразительные глаза"s,
+        "ухоженный скворец евгений"s,
+        "пушистый скворец и белый хвост"s,
+    };
+
+    SearchServer expected("и в на"s);
+    SearchServer seq_server("и в на"s);
+    SearchServer par_server("и в на"s);
+    expected.AddDocument(3, "кот и пёс"s, DocumentStatus::ACTUAL, {1});
+    seq_server.AddDocument(3, "кот и пёс"s, DocumentStatus::ACTUAL, {1});
+    par_server.AddDocument(3, "кот и пёс"s, DocumentStatus::ACTUAL, {1});
+
+    std::vector<RawDocument> documents;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const int id = static_cast<int>(i * 2);
+        const auto status = i % 2 == 0 ? DocumentStatus::ACTUAL : DocumentStatus::BANNED;
+        const std::vector<int> ratings {static_cast<int>(i), 3};
+        expected.AddDocument(id, texts[i], status, ratings);
+        documents.push_back({id, texts[i], status, ratings});
+    }
+    seq_server.AddDocuments(documents);
+    par_server.AddDocuments(std::execution::par, documents);
+
+    for (const SearchServer* server : {&seq_server, &par_server}) {
+        ASSERT_EQUAL(server->GetDocumentCount(), expected.GetDocumentCount());
+        for (const int id : {0, 2, 3, 4, 6, 8}) {
+            ASSERT_EQUAL_HINT(server->GetWordFrequencies(id), expected.GetWordFrequencies(id),
+                              "Пакетное добавление должно давать тот же индекс"s);
+        }
+        for (const std::string& query : {"пушистый ухоженный кот"s, "белый хвост -кот"s, "скворец пёс"s}) {
+            for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+                const auto found_docs = server->FindTopDocuments(query, status);
+                const auto expected_docs = expected.FindTopDocuments(query, status);
+                ASSERT_EQUAL(found_docs.size(), expected_docs.size());
+                for (size_t i = 0; i < found_docs.size(); ++i) {
+                    ASSERT_EQUAL(found_docs[i].id, expected_docs[i].id);
+                    ASSERT_EQUAL(found_docs[i].relevance, expected_docs[i].relevance);
+                    ASSERT_EQUAL(found_docs[i].rating, expected_docs[i].rating);
+                }
+            }
+        }
+    }
+
+    const std::vector<RawDocument> duplicates {{100, "кот"sv, DocumentStatus::ACTUAL, {}},
+                                               {100, "пёс"sv, DocumentStatus::ACTUAL, {}}};
+    bool thrown = false;
+    try {
+        par_server.AddDocuments(std::execution::par, duplicates);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Повторяющиеся id в пакете должны отклоняться"s);
+    ASSERT_EQUAL_HINT(par_server.GetDocumentCount(), expected.GetDocumentCount(),
+                      "Некорректный пакет не должен добавлять документы"s);
+}
+
+void TestIndexSnapshot()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s,          DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(1, "пушистый кот пушистый хвост"s,         DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "ухоженный пёс выразительные глаза"s,   DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    server.AddDocument(3, "ухоженный скворец евгений"s,           DocumentStatus::BANNED, {9});
+    server.AddDocument(500, "пушистый скворец и белый хвост"s,    DocumentStatus::ACTUAL, {1});
+    server.AddDocument(7, "удалённый кот"s,                       DocumentStatus::ACTUAL, {1});
+    server.RemoveDocument(7);
+
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / "search_server_snapshot_test.bin").string();
+    server.SaveSnapshot(path);
+    {
+        const IndexSnapshot snapshot(path);
+        // Повторное сохранение заменяет файл, не трогая отображённый
+        server.SaveSnapshot(path);
+        ASSERT_EQUAL(snapshot.GetDocumentCount(), server.GetDocumentCount());
+        for (const std::string& query : {"пушистый ухоженный кот"s, "белый хвост -кот"s,
+                                         "скворец и евгений"s, "удалённый"s, ""s}) {
+            for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+                const auto found_docs = snapshot.FindTopDocuments(query, status);
+                const auto expected = server.FindTopDocuments(query, status);
+                ASSERT_EQUAL_HINT(found_docs.size(), expected.size(),
+                                  "Поиск по снимку должен совпадать с поиском по серверу"s);
+                for (size_t i = 0; i < found_docs.size(); ++i) {
+                    ASSERT_EQUAL(found_docs[i].id, expected[i].id);
+                    ASSERT(std::abs(found_docs[i].relevance - expected[i].relevance) < EPSILON);
+                    ASSERT_EQUAL(found_docs[i].rating, expected[i].rating);
+                }
+            }
+        }
+    }
+
+    // Повреждённые копии снимка отвергаются при открытии, а не читаются за границами
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    const auto read_field = [&bytes](size_t offset) {
+        uint64_t value = 0;
+        std::memcpy(&value, bytes.data() + offset, sizeof(value));
+        return value;
+    };
+    // Поля заголовка: terms_offset по смещению 40, posting_count - 48,
+    // posting_ids_offset - 56;
+    // в записи слова размер строки по смещению 8, first_posting - 16
+    const size_t terms_offset = static_cast<size_t>(read_field(40));
+    const std::vector<std::pair<size_t, uint64_t>> corruptions {
+        {40, ~uint64_t{0} - 7},
+        {48, ~uint64_t{0} / 4},
+        {terms_offset + 8, uint64_t{1} << 40},
+        {terms_offset + 16, ~uint64_t{0}},
+    };
+    const std::string corrupted_path = path + ".corrupted"s;
+    for (const auto& [offset, value] : corruptions) {
+        std::string corrupted = bytes;
+        std::memcpy(corrupted.data() + offset, &value, sizeof(value));
+        std::ofstream(corrupted_path, std::ios::binary) << corrupted;
+
+        bool thrown = false;
+        try {
+            IndexSnapshot snapshot(corrupted_path);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        ASSERT_HINT(thrown, "Повреждённый снимок не должен открываться"s);
+    }
+    std::ofstream(corrupted_path, std::ios::binary) << bytes.substr(0, bytes.size() / 2);
+    bool thrown = false;
+    try {
+        IndexSnapshot snapshot(corrupted_path);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    // Списки документов при открытии не читаются: неизвестный id
+    // обнаруживается поиском, который до него дошёл
+    {
+        std::string corrupted = bytes;
+        const size_t posting_ids_offset = static_cast<size_t>(read_field(56));
+        const size_t posting_count = static_cast<size_t>(read_field(48));
+        for (size_t i = 0; i < posting_count; ++i) {
+            const int32_t unknown_id = 12345;
+            std::memcpy(corrupted.data() + posting_ids_offset + i * sizeof(unknown_id),
+                        &unknown_id, sizeof(unknown_id));
+        }
+        std::ofstream(corrupted_path, std::ios::binary) << corrupted;
+    }
+    {
+        const IndexSnapshot snapshot(corrupted_path);
+        thrown = false;
+        try {
+            snapshot.FindTopDocuments("кот"s);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+
+    std::remove(corrupted_path.c_str());
+    std::remove(path.c_str());
+}
+
+void TestCompressedPostings()
+{
+    std::vector<int> ids;
+    std::vector<double> freqs;
+    for (int i = 0; i < 1000; ++i) {
+        ids.push_back(i * i * 3 + (i % 2));
+        freqs.push_back(1.0 / (i + 1));
+    }
+
+    PostingList postings;
+    postings.is_compressed = true;
+    postings.compressed = std::make_unique<CompressedPostings>();
+    postings.compressed->Assign(ids, freqs);
+    ASSERT_EQUAL(postings.size(), ids.size());
+    ASSERT_EQUAL(postings.compressed->GetBlockCount(),
+                 (ids.size() + CompressedPostings::BLOCK_SIZE - 1) / CompressedPostings::BLOCK_SIZE);
+
+    std::vector<int> decoded_ids;
+    std::vector<double> decoded_freqs;
+    postings.compressed->Decode(decoded_ids, decoded_freqs);
+    ASSERT_EQUAL_HINT(decoded_ids, ids, "Распакованные id должны совпадать с исходными"s);
+    for (size_t i = 0; i < freqs.size(); ++i) {
+        ASSERT(std::abs(decoded_freqs[i] - freqs[i]) < 1e-7);
+    }
+
+    auto cursor = postings.GetCursor();
+    cursor.Seek(ids[500]);
+    ASSERT_EQUAL(cursor.DocumentId(), ids[500]);
+    cursor.Seek(ids[700] - 1);
+    ASSERT_EQUAL_HINT(cursor.DocumentId(), ids[700], "Seek должен переходить к первому id не меньше заданного"s);
+    cursor.Next();
+    ASSERT_EQUAL(cursor.DocumentId(), ids[701]);
+    cursor.Seek(ids.back() + 1);
+    ASSERT(cursor.AtEnd());
+
+    // Seek находит нужный блок и позицию в нём при любом шаге
+    for (const size_t step : {1ul, 37ul, 129ul, 400ul}) {
+        auto stepping_cursor = postings.GetCursor();
+        for (size_t i = step; i < ids.size(); i += step) {
+            stepping_cursor.Seek(ids[i - 1] + 1);
+            ASSERT_EQUAL(stepping_cursor.DocumentId(), ids[i]);
+        }
+    }
+
+    // Курсор простого списка не несёт буфер для блоков сжатого
+    ASSERT(sizeof(PostingList::Cursor) < CompressedPostings::BLOCK_SIZE * sizeof(int));
+}
+
+void TestCompressedIndex()
+{
+    SearchServer plain("и в на"s);
+    SearchServer compressed("и в на"s, PostingFormat::COMPRESSED);
+    const std::vector<std::string> words {"кот"s, "пёс"s, "хвост"s, "глаза"s, "ошейник"s,
+                                          "белый"s, "пушистый"s, "модный"s, "скворец"s};
+    std::vector<std::string> texts;
+    for (int id = 0; id < 600; ++id) {
+        std::string text;
+        for (size_t i = 0; i < words.size(); ++i) {
+            if ((id * 7 + static_cast<int>(i) * 3) % (static_cast<int>(i) + 2) == 0) {
+                text += words[i] + " и "s;
+            }
+        }
+        texts.push_back(text + words[static_cast<size_t>(id) % words.size()]);
+    }
+    for (int id = 599; id >= 300; --id) {
+        plain.AddDocument(id, texts[static_cast<size_t>(id)], DocumentStatus::ACTUAL, {id % 11});
+        compressed.AddDocument(id, texts[static_cast<size_t>(id)], DocumentStatus::ACTUAL, {id % 11});
+    }
+    std::vector<RawDocument> batch;
+    for (int id = 0; id < 300; ++id) {
+        batch.push_back({id, texts[static_cast<size_t>(id)], DocumentStatus::ACTUAL, {id % 11}});
+    }
+    plain.AddDocuments(batch);
+    compressed.AddDocuments(batch);
+    for (int id = 0; id < 600; id += 7) {
+        plain.RemoveDocument(id);
+        compressed.RemoveDocument(id);
+    }
+    ASSERT_HINT(compressed.GetPostingsMemoryUsage() * 2 < plain.GetPostingsMemoryUsage(),
+                "Сжатые списки должны занимать меньше половины памяти обычных"s);
+
+    for (const std::string& query : {"кот пёс хвост"s, "пушистый белый -кот скворец"s,
+                                     "глаза модный ошейник пёс -хвост"s}) {
+        const auto expected = plain.FindTopDocuments(query, DocumentStatus::ACTUAL, 20);
+        for (const auto& found_docs : {compressed.FindTopDocuments(query, DocumentStatus::ACTUAL, 20),
+                                       compressed.FindTopDocumentsWithPruning(query, DocumentStatus::ACTUAL, 20)}) {
+            ASSERT_EQUAL_HINT(found_docs.size(), expected.size(),
+                              "Поиск по сжатому индексу должен совпадать с обычным"s);
+            for (size_t i = 0; i < found_docs.size(); ++i) {
+                ASSERT(std::abs(found_docs[i].relevance - expected[i].relevance) < EPSILON);
+                ASSERT_EQUAL(found_docs[i].rating, expected[i].rating);
+            }
+        }
+        ASSERT_EQUAL(std::get<0>(compressed.MatchDocument(query, 302)),
+                     std::get<0>(plain.MatchDocument(query, 302)));
+    }
+}
+
+void TestSplitIntoWords()
+{
+    // Слова пересекают границы 16-байтных блоков векторной обработки
+    std::string text;
+    std::vector<std::string_view> expected_words;
+    std::vector<std::string> words;
+    for (int i = 0; i < 40; ++i) {
+        words.push_back(std::string(static_cast<size_t>(i % 7 + 1), static_cast<char>('a' + i % 26)));
+    }
+    for (size_t i = 0; i < words.size(); ++i) {
+        text += std::string(i % 3 + 1, ' ') + words[i];
+        expected_words.push_back(words[i]);
+    }
+    text += "  ";
+
+    ASSERT_EQUAL(SplitIntoWords(text), expected_words);
+    std::vector<std::string_view> valid_words {"старое"sv};
+    ASSERT(SplitIntoValidWords(text, valid_words));
+    valid_words.erase(valid_words.begin());
+    ASSERT_EQUAL(valid_words, expected_words);
+    ASSERT_EQUAL(SplitIntoWords("белый  кот "sv), (std::vector<std::string_view>{"белый"sv, "кот"sv}));
+    ASSERT(SplitIntoWords("   "sv).empty());
+
+    std::vector<std::string_view> buffer;
+    for (size_t pos = 0; pos < 40; ++pos) {
+        std::string invalid(40, 'x');
+        invalid[pos] = '\x12';
+        buffer.clear();
+        ASSERT_HINT(!SplitIntoValidWords(invalid, buffer),
+                    "Управляющий символ должен находиться в любой позиции"s);
+    }
+
+    SearchServer server;
+    bool thrown = false;
+    try {
+        server.AddDocument(1, std::string(20, 'x') + "\x01"s, DocumentStatus::ACTUAL, {1});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Документ с управляющим символом должен отклоняться"s);
+    ASSERT_EQUAL(server.GetDocumentCount(), 0);
+}
+
+void TestQueryContext()
+{
+    SearchServer dense_server("и в на"sv);
+    SearchServer sparse_server("и в на"sv);
+    const std::vector<std::string> texts {"белый кот и модный ошейник"s,
+                                          "пушистый кот пушистый хвост"s,
+                                          "ухоженный пёс выразительные глаза"s,
+                                          "ухоженный скворец евгений"s};
+    for (int id = 0; id < 40; ++id) {
+        const std::string& text = texts[static_cast<size_t>(id) % texts.size()];
+        dense_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id});
+        sparse_server.AddDocument(id * 1000, text, DocumentStatus::ACTUAL, {id});
+    }
+
+    SearchServer::QueryContext context;
+    const std::vector<std::string_view> queries {"пушистый ухоженный кот"sv,
+                                                 "кот -хвост"sv,
+                                                 "евгений"sv,
+                                                 "неизвестное слово"sv,
+                                                 "пушистый ухоженный кот"sv};
+    for (const SearchServer* server : {&dense_server, &sparse_server}) {
+        for (const std::string_view query : queries) {
+            const std::vector<Document> expected = server->FindTopDocuments(query);
+            const std::vector<Document>& found = server->FindTopDocuments(context, query);
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL(found[i].id, expected[i].id);
+                ASSERT_EQUAL(found[i].relevance, expected[i].relevance);
+                ASSERT_EQUAL(found[i].rating, expected[i].rating);
+            }
+        }
+    }
+
+    const auto& odd = dense_server.FindTopDocuments(context, "кот"sv,
+                                                    [](int document_id, DocumentStatus, int) {
+                                                        return document_id % 2 == 1;
+                                                    }, 100);
+    ASSERT_EQUAL(odd.size(), 10ul);
+    for (const Document& document : odd) {
+        ASSERT_EQUAL(document.id % 4, 1);
+    }
+}
+
+void TestStopWords()
+{
+    std::vector<std::string> words;
+    for (int i = 0; i < 500; ++i) {
+        words.push_back("слово"s + std::to_string(i));
+    }
+    words.push_back("слово7"s);
+    words.push_back(""s);
+    const StopWords stop_words(words);
+    for (int i = 0; i < 500; ++i) {
+        ASSERT(stop_words.Contains("слово"s + std::to_string(i)));
+        ASSERT(!stop_words.Contains("слово"s + std::to_string(i + 500)));
+    }
+    ASSERT(!stop_words.Contains("слово"sv));
+    ASSERT_EQUAL(stop_words.GetSortedWords().size(), 500ul);
+    ASSERT(!StopWords{}.Contains("и"sv));
+
+    // Слова с одинаковым хешем нельзя разместить в идеальной таблице
+    {
+        const std::vector<uint64_t> hashes {5, 17, 5};
+        const size_t table_size = perfect_hash::GetTableSize(hashes.size());
+        std::vector<uint32_t> seeds(table_size), slots(table_size), bucket_sizes(table_size);
+        bool thrown = false;
+        try {
+            perfect_hash::Build(hashes, hashes.size(), seeds, slots, bucket_sizes, table_size);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+
+    static constexpr StaticStopWords static_stop_words {std::array{"и"sv, "в"sv, "на"sv}};
+    static_assert(static_stop_words.Contains("в"sv));
+    static_assert(!static_stop_words.Contains("кот"sv));
+
+    SearchServer server(static_stop_words);
+    server.AddDocument(1, "кот в городе"sv, DocumentStatus::ACTUAL, {1});
+    ASSERT(server.FindTopDocuments("в"sv).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("кот"sv).size(), 1ul);
+    ASSERT_EQUAL(server.GetWordFrequencies(1).size(), 2ul);
+}
+
+void TestShardedSearchServer()
+{
+    const std::vector<std::string> texts {"белый кот и модный ошейник"s,
+                                          "пушистый кот пушистый хвост"s,
+                                          "ухоженный пёс выразительные глаза"s,
+                                          "ухоженный скворец евгений"s,
+                                          "белый пёс"s};
+    SearchServer server("и в на"sv);
+    ShardedSearchServer sharded_server("и в на"sv, 3);
+    for (int id = 0; id < 50; ++id) {
+        const std::string& text = texts[static_cast<size_t>(id * 7) % texts.size()];
+        const auto status = id % 6 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        server.AddDocument(id, text, status, {id % 10});
+        sharded_server.AddDocument(id, text, status, {id % 10});
+    }
+    ASSERT_EQUAL(sharded_server.GetShardCount(), 3ul);
+    ASSERT_EQUAL(ShardedSearchServer(4).GetShardCount(), 4ul);
+    ASSERT_EQUAL(sharded_server.GetDocumentCount(), server.GetDocumentCount());
+
+    const auto check_same_results = [&](const std::string_view query) {
+        const std::vector<Document> expected = server.FindTopDocuments(query);
+        for (const std::vector<Document>& found
+                : {sharded_server.FindTopDocuments(query),
+                   sharded_server.FindTopDocuments(std::execution::par, query)}) {
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_HINT(std::abs(found[i].relevance - expected[i].relevance) < EPSILON,
+                            "IDF должен считаться по всем шардам"s);
+                ASSERT_EQUAL(found[i].rating, expected[i].rating);
+            }
+        }
+    };
+    check_same_results("пушистый ухоженный кот"sv);
+    check_same_results("белый -кот евгений"sv);
+    check_same_results("неизвестное слово"sv);
+
+    ASSERT_EQUAL(std::get<0>(sharded_server.MatchDocument("белый кот"sv, 5)),
+                 std::get<0>(server.MatchDocument("белый кот"sv, 5)));
+
+    server.RemoveDocument(4);
+    sharded_server.RemoveDocument(4);
+    check_same_results("пушистый ухоженный кот"sv);
+
+    const std::vector<RawDocument> invalid_batch {{100, "кот"sv, DocumentStatus::ACTUAL, {}},
+                                                  {101, "пёс\x01"sv, DocumentStatus::ACTUAL, {}}};
+    bool thrown = false;
+    try {
+        sharded_server.AddDocuments(std::execution::par, invalid_batch);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT_EQUAL_HINT(sharded_server.GetDocumentCount(), server.GetDocumentCount(),
+                      "Некорректный пакет не должен добавлять документы"s);
+    check_same_results("пушистый ухоженный кот"sv);
+}
+
+void TestConcurrentSearchServer()
+{
+    ConcurrentSearchServer server("и в на"sv);
+    server.AddDocument(0, "белый кот"sv, DocumentStatus::ACTUAL, {1});
+
+    // Все документы, кроме первого, содержат слово "пёс", поэтому запрос,
+    // видящий индекс и список документов в разных состояниях, заметит расхождение
+    std::atomic_bool done = false;
+    std::atomic_int inconsistent_reads = 0;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i) {
+        readers.emplace_back([&server, &done, &inconsistent_reads] {
+            while (!done) {
+                const ConcurrentSearchServer::Snapshot snapshot = server.GetSnapshot();
+                const auto found = snapshot->FindTopDocuments("пёс"sv, DocumentStatus::ACTUAL, 1000);
+                if (static_cast<int>(found.size()) + 1 != snapshot->GetDocumentCount()) {
+                    ++inconsistent_reads;
+                }
+            }
+        });
+    }
+
+    for (int id = 1; id < 200; id += 2) {
+        const std::vector<RawDocument> pair {{id, "пёс"sv, DocumentStatus::ACTUAL, {1}},
+                                             {id + 1, "ухоженный пёс"sv, DocumentStatus::ACTUAL, {2}}};
+        server.AddDocuments(pair);
+        if (id % 10 == 1) {
+            server.AddDocuments(std::vector<RawDocument>{{1000, "пёс"sv, DocumentStatus::ACTUAL, {}},
+                                                         {1001, "пёс"sv, DocumentStatus::ACTUAL, {}}});
+            server.RemoveDocument(1000);
+            server.RemoveDocument(1001);
+        }
+    }
+    done = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQUAL(inconsistent_reads.load(), 0);
+    ASSERT_EQUAL(server.GetDocumentCount(), 201);
+    ASSERT_EQUAL(server.FindTopDocuments("пёс"sv, DocumentStatus::ACTUAL, 1000).size(), 200ul);
+
+    bool thrown = false;
+    try {
+        server.AddDocument(5, "кот"sv, DocumentStatus::ACTUAL, {});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT_EQUAL(std::get<0>(server.MatchDocument("белый кот"sv, 0)).size(), 2ul);
+
+    // Удаление уникальных слов перекладывает строки слов индекса,
+    // а найденные раньше слова должны остаться целыми
+    ConcurrentSearchServer words_server("и в на"sv);
+    std::vector<std::string> texts;
+    for (int id = 0; id < 4000; ++id) {
+        texts.push_back("кот слово"s + std::to_string(id));
+    }
+    std::vector<RawDocument> documents;
+    for (int id = 0; id < 4000; ++id) {
+        documents.push_back({id, texts[static_cast<size_t>(id)], DocumentStatus::ACTUAL, {1}});
+    }
+    words_server.AddDocuments(documents);
+    const auto [words, status] = words_server.MatchDocument("кот"sv, 0);
+    for (int id = 1; id < 4000; ++id) {
+        words_server.RemoveDocument(id);
+    }
+    ASSERT_EQUAL(words.size(), 1ul);
+    ASSERT_EQUAL(words[0], "кот"s);
+    ASSERT(status == DocumentStatus::ACTUAL);
+}
+
+void TestSegmentedSearchServer()
+{
+    const std::vector<std::string> texts {"белый кот и модный ошейник"s,
+                                          "пушистый кот пушистый хвост"s,
+                                          "ухоженный пёс выразительные глаза"s,
+                                          "ухоженный скворец евгений"s,
+                                          "белый пёс"s};
+    SearchServer server("и в на"sv);
+    SegmentedSearchServer segmented_server("и в на"sv, 4);
+    const auto add_document = [&](int id) {
+        const std::string& text = texts[static_cast<size_t>(id * 7) % texts.size()];
+        const auto status = id % 6 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        server.AddDocument(id, text, status, {id % 10});
+        segmented_server.AddDocument(id, text, status, {id % 10});
+    };
+    const auto check_same_results = [&](const std::string_view query) {
+        ASSERT_EQUAL(segmented_server.GetDocumentCount(), server.GetDocumentCount());
+        const std::vector<Document> expected = server.FindTopDocuments(query);
+        for (const std::vector<Document>& found
+                : {segmented_server.FindTopDocuments(query),
+                   segmented_server.FindTopDocuments(std::execution::par, query)}) {
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_HINT(std::abs(found[i].relevance - expected[i].relevance) < EPSILON,
+                            "IDF должен считаться по живым документам всех сегментов"s);
+                ASSERT_EQUAL(found[i].rating, expected[i].rating);
+            }
+        }
+    };
+
+    for (int id = 0; id < 50; ++id) {
+        add_document(id);
+    }
+    // Удаления до слияния только отмечают документы в сегментах
+    for (int id = 0; id < 50; id += 7) {
+        server.RemoveDocument(id);
+        segmented_server.RemoveDocument(id);
+    }
+    check_same_results("пушистый ухоженный кот"sv);
+    check_same_results("белый -кот евгений"sv);
+
+    segmented_server.WaitForMerges();
+    ASSERT_HINT(segmented_server.GetSegmentCount() < 12ul, "Сегменты должны сливаться"s);
+    check_same_results("пушистый ухоженный кот"sv);
+    check_same_results("белый -кот евгений"sv);
+    check_same_results("неизвестное слово"sv);
+
+    // Удаление из слитого сегмента и повторное добавление того же id
+    server.RemoveDocument(15);
+    segmented_server.RemoveDocument(15);
+    add_document(15);
+    add_document(7);
+    check_same_results("пушистый ухоженный кот"sv);
+    ASSERT_EQUAL(segmented_server.GetWordFrequencies(15).size(), server.GetWordFrequencies(15).size());
+    const auto expected_words = std::get<0>(server.MatchDocument("белый кот"sv, 15));
+    ASSERT_EQUAL(std::get<0>(segmented_server.MatchDocument("белый кот"sv, 15)),
+                 std::vector<std::string>(expected_words.begin(), expected_words.end()));
+
+    bool thrown = false;
+    try {
+        segmented_server.AddDocument(16, "кот"sv, DocumentStatus::ACTUAL, {});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "id из замороженного сегмента уже занят"s);
+
+    thrown = false;
+    try {
+        segmented_server.RemoveDocument(0);
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestRemoveDuplicates()
+{
+    const auto create_server = [] {
+        SearchServer server("and with"sv);
+        server.AddDocument(1, "funny pet and nasty rat"sv, DocumentStatus::ACTUAL, {7, 2, 7});
+        server.AddDocument(2, "funny pet with curly hair"sv, DocumentStatus::ACTUAL, {1, 2});
+        // Тот же набор слов, что у 2: частоты и стоп-слова не важны
+        server.AddDocument(3, "funny pet with curly hair hair"sv, DocumentStatus::ACTUAL, {1, 2});
+        server.AddDocument(4, "curly hair funny pet"sv, DocumentStatus::BANNED, {1, 2});
+        // Слов меньше, это не дубликат
+        server.AddDocument(5, "funny pet curly"sv, DocumentStatus::ACTUAL, {1, 2});
+        server.AddDocument(6, "nasty rat funny pet and"sv, DocumentStatus::ACTUAL, {1, 1, 1});
+        server.AddDocument(7, "very nasty rat and not very funny pet"sv, DocumentStatus::ACTUAL, {1, 2});
+        return server;
+    };
+
+    SearchServer server = create_server();
+    ASSERT_EQUAL(RemoveDuplicates(server), std::vector<int>({3, 4, 6}));
+    ASSERT_EQUAL(server.GetDocumentCount(), 4);
+    ASSERT_EQUAL(std::vector<int>(server.begin(), server.end()), std::vector<int>({1, 2, 5, 7}));
+    ASSERT(RemoveDuplicates(server).empty());
+
+    SearchServer par_server = create_server();
+    ASSERT_EQUAL(RemoveDuplicates(std::execution::par, par_server), std::vector<int>({3, 4, 6}));
+    ASSERT_EQUAL(std::vector<int>(par_server.begin(), par_server.end()),
+                 std::vector<int>({1, 2, 5, 7}));
+}
+
+void TestNearDuplicates()
+{
+    SearchServer server("and with"sv);
+    // 1, 3 и 6 отличаются от соседей одним словом из десяти
+    server.AddDocument(1, "white cat with fashionable collar sits on the warm window"sv, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "fluffy dog chases a red ball in the park"sv, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "white cat with fashionable collar sits on the cold window"sv, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "groomed starling named eugene sings songs"sv, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(5, "fluffy dog chases a blue ball"sv, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(6, "black cat with fashionable collar sits on the warm window"sv, DocumentStatus::ACTUAL, {6});
+    server.AddDocument(7, "and with"sv, DocumentStatus::ACTUAL, {7});
+    server.AddDocument(8, "fluffy dog chases a red ball in the park"sv, DocumentStatus::ACTUAL, {8});
+
+    const std::vector<std::vector<int>> expected {{1, 3, 6}, {2, 8}};
+    ASSERT(FindNearDuplicates(server, {0.75, 20, 5}) == expected);
+    ASSERT(FindNearDuplicates(std::execution::par, server, {0.75, 20, 5}) == expected);
+    ASSERT_HINT(FindNearDuplicates(server, {1.0, 20, 5}) == std::vector<std::vector<int>>({{2, 8}}),
+                "При пороге 1 почти-дубликаты - это точные дубликаты"s);
+
+    ASSERT_EQUAL(RemoveNearDuplicates(std::execution::par, server, {0.75, 20, 5}),
+                 std::vector<int>({3, 6, 8}));
+    ASSERT_EQUAL(std::vector<int>(server.begin(), server.end()), std::vector<int>({1, 2, 4, 5, 7}));
+    ASSERT(FindNearDuplicates(server, {0.75, 20, 5}).empty());
+
+    // Полоса совпала у всех трёх документов, но первый - случайное совпадение:
+    // пара из второго и третьего всё равно должна найтись
+    const std::map<std::string_view, double> collar {{"collar"sv, 1.0}, {"cat"sv, 1.0}};
+    const std::map<std::string_view, double> ball {{"red"sv, 0.5}, {"ball"sv, 0.5}};
+    const std::map<std::string_view, double> same_ball {{"red"sv, 1.0}, {"ball"sv, 1.0}};
+    const std::vector<uint64_t> band_hashes(3, 42);
+    const auto pairs = FindSimilarPairsInBand({&collar, &ball, &same_ball}, band_hashes.data(), 0.8);
+    ASSERT(pairs == (std::vector<std::pair<size_t, size_t>>{{1, 2}}));
+
+    // 11 и 12 похожи, 12 и 13 похожи, а 11 и 13 нет: удаляется только 12
+    SearchServer chain_server(""sv);
+    chain_server.AddDocument(11, "a b c d e f g h i j"sv, DocumentStatus::ACTUAL, {1});
+    chain_server.AddDocument(12, "a b c d e f g h i k"sv, DocumentStatus::ACTUAL, {1});
+    chain_server.AddDocument(13, "a b c d e f g h k l"sv, DocumentStatus::ACTUAL, {1});
+    ASSERT(FindNearDuplicates(chain_server, {0.8, 20, 5}) == std::vector<std::vector<int>>({{11, 12, 13}}));
+    ASSERT_EQUAL(RemoveNearDuplicates(chain_server, {0.8, 20, 5}), std::vector<int>({12}));
+    ASSERT_EQUAL(std::vector<int>(chain_server.begin(), chain_server.end()), std::vector<int>({11, 13}));
+}
+
+void TestRemoveDocuments()
+{
+    // Уникальные слова документов занимают больше блока хранилища слов,
+    // поэтому после удаления большинства документов оно перекладывается
+    const auto unique_word = [](int id) {
+        return "уникальноеслово"s + std::to_string(id);
+    };
+    const auto create_server = [&unique_word] {
+        SearchServer server("и в на"sv);
+        for (int id = 0; id < 3000; ++id) {
+            server.AddDocument(id, (id % 2 == 0 ? "белый кот "s : "пушистый пёс "s) + unique_word(id),
+                               DocumentStatus::ACTUAL, {id % 10});
+        }
+        return server;
+    };
+
+    SearchServer server = create_server();
+    bool thrown = false;
+    try {
+        server.RemoveDocuments({1, 2, 5000});
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT_EQUAL_HINT(server.GetDocumentCount(), 3000, "При ошибке не удаляется ни один документ"s);
+
+    std::vector<int> removed;
+    for (int id = 0; id < 3000; ++id) {
+        if (id % 10 != 0) removed.push_back(id);
+    }
+    SearchServer par_server = create_server();
+    server.RemoveDocuments(removed);
+    par_server.RemoveDocuments(std::execution::par, removed);
+
+    for (SearchServer* s : {&server, &par_server}) {
+        ASSERT_EQUAL(s->GetDocumentCount(), 300);
+        ASSERT_EQUAL(s->FindTopDocuments("белый кот"sv, DocumentStatus::ACTUAL, 1000).size(), 300ul);
+        ASSERT(s->FindTopDocuments("пушистый"sv).empty());
+        ASSERT(s->FindTopDocuments(unique_word(7)).empty());
+        for (const int id : {0, 1230, 2990}) {
+            const std::string word = unique_word(id);
+            const std::map<std::string_view, double> expected {{"белый"sv, 1.0 / 3},
+                                                               {"кот"sv, 1.0 / 3},
+                                                               {word, 1.0 / 3}};
+            ASSERT_EQUAL_HINT(s->GetWordFrequencies(id), expected,
+                              "Частоты должны ссылаться на переложенные строки слов"s);
+        }
+    }
+
+    // Освобождённые слова можно добавить снова
+    server.AddDocument(7, "пушистый "s + unique_word(7), DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(server.FindTopDocuments(unique_word(7)).size(), 1ul);
+    ASSERT_EQUAL(std::get<0>(server.MatchDocument("пушистый кот"sv, 7)),
+                 std::vector<std::string_view>({"пушистый"sv}));
+    server.RemoveDocument(7);
+    ASSERT(server.FindTopDocuments("пушистый"sv).empty());
+}
+
+void TestQueryCache()
+{
+    SearchServer server("и в на"sv);
+    server.AddDocument(1, "белый кот и модный ошейник"sv, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(2, "пушистый кот пушистый хвост"sv, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(3, "ухоженный пёс выразительные глаза"sv, DocumentStatus::BANNED, {5});
+
+    QueryCache cache(server, 64);
+    const auto expected = server.FindTopDocuments("пушистый кот"sv);
+    const auto first = cache.FindTopDocuments("пушистый кот"sv);
+    ASSERT_EQUAL(first.size(), expected.size());
+    ASSERT_EQUAL(cache.GetMissCount(), 1ul);
+
+    // Порядок слов, повторы, стоп-слова и неизвестные слова на ключ не влияют
+    const auto second = cache.FindTopDocuments("кот и пушистый кот неизвестное"sv);
+    ASSERT_EQUAL(cache.GetHitCount(), 1ul);
+    ASSERT_EQUAL(second.size(), first.size());
+    for (size_t i = 0; i < first.size(); ++i) {
+        ASSERT_EQUAL(second[i].id, first[i].id);
+    }
+
+    // Статус и минус-слова входят в ключ
+    ASSERT_EQUAL(cache.FindTopDocuments("пушистый кот"sv, DocumentStatus::BANNED).size(), 0ul);
+    ASSERT_EQUAL(cache.FindTopDocuments("пушистый кот -хвост"sv).size(), 1ul);
+    ASSERT_EQUAL(cache.GetMissCount(), 3ul);
+
+    // Изменение индекса делает закэшированные результаты устаревшими
+    server.AddDocument(4, "пушистый кот"sv, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(cache.FindTopDocuments("пушистый кот"sv).size(), 3ul);
+    ASSERT_EQUAL(cache.GetMissCount(), 4ul);
+    server.RemoveDocument(4);
+    ASSERT_EQUAL(cache.FindTopDocuments("пушистый кот"sv).size(), 2ul);
+    ASSERT_EQUAL(cache.GetHitCount(), 1ul);
+
+    for (int i = 0; i < 200; ++i) {
+        server.AddDocument(100 + i, "слово"s + std::to_string(i), DocumentStatus::ACTUAL, {});
+    }
+    for (int i = 0; i < 200; ++i) {
+        cache.FindTopDocuments("слово"s + std::to_string(i));
+    }
+    ASSERT_HINT(cache.GetSize() <= 64u, "Размер кэша ограничен"s);
+
+    RequestQueue request_queue(server);
+    request_queue.AddFindRequest("пушистый кот"s);
+    request_queue.AddFindRequest("кот пушистый"s);
+    request_queue.AddFindRequest("пустой запрос"s);
+    ASSERT_EQUAL(request_queue.GetCache().GetHitCount(), 1ul);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1);
+
+    // Сервер, перемещённый на место закэшированного, не получает его версию,
+    // даже если изменялся столько же раз
+    SearchServer cached_server;
+    cached_server.AddDocument(1, "пушистый кот"sv, DocumentStatus::ACTUAL, {1});
+    SearchServer other;
+    other.AddDocument(2, "кот"sv, DocumentStatus::ACTUAL, {1});
+    QueryCache moved_cache(cached_server);
+    ASSERT_EQUAL(moved_cache.FindTopDocuments("кот"sv)[0].id, 1);
+    cached_server = std::move(other);
+    ASSERT_EQUAL(moved_cache.FindTopDocuments("кот"sv)[0].id, 2);
+    ASSERT_EQUAL(moved_cache.GetHitCount(), 0ul);
+}
+
+void TestFindTopDocumentsBatch()
+{
+    const std::vector<std::string> words {"белый"s, "кот"s, "модный"s, "ошейник"s, "пушистый"s,
+                                          "хвост"s, "ухоженный"s, "пёс"s, "скворец"s, "евгений"s};
+    SearchServer server("и в на"sv);
+    for (int id = 0; id < 300; ++id) {
+        std::string text;
+        for (size_t i = 0; i < 4; ++i) {
+            text += words[static_cast<size_t>(id * 7 + static_cast<int>(i * i) * 3) % words.size()] + " "s;
+        }
+        const auto status = id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        server.AddDocument(id, text, status, {id % 10});
+    }
+
+    std::vector<std::string> queries;
+    for (size_t i = 0; i < 60; ++i) {
+        queries.push_back(words[i % words.size()] + " "s + words[(i * 3 + 1) % words.size()]
+                          + (i % 4 == 0 ? " -"s + words[(i + 5) % words.size()] : ""s)
+                          + (i % 7 == 0 ? " неизвестное"s : ""s));
+    }
+    queries.push_back("и в на"s);
+
+    const auto check_results = [&](const std::vector<std::vector<Document>>& results,
+                                   DocumentStatus status) {
+        ASSERT_EQUAL(results.size(), queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto expected = server.FindTopDocuments(queries[i], status);
+            ASSERT_EQUAL(results[i].size(), expected.size());
+            for (size_t j = 0; j < expected.size(); ++j) {
+                ASSERT_EQUAL(results[i][j].id, expected[j].id);
+                ASSERT(std::abs(results[i][j].relevance - expected[j].relevance) < EPSILON);
+                ASSERT_EQUAL(results[i][j].rating, expected[j].rating);
+            }
+        }
+    };
+    check_results(server.FindTopDocumentsBatch(queries), DocumentStatus::ACTUAL);
+    check_results(server.FindTopDocumentsBatch(std::execution::par, queries, DocumentStatus::BANNED),
+                  DocumentStatus::BANNED);
+    check_results(ProcessQueries(server, queries), DocumentStatus::ACTUAL);
+
+    bool thrown = false;
+    try {
+        server.FindTopDocumentsBatch(std::vector<std::string>{"кот"s, "кот --пёс"s});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestProcessQueriesJoined()
+{
+    SearchServer server("и в на"sv);
+    server.AddDocument(1, "белый кот и модный ошейник"sv, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(2, "пушистый кот пушистый хвост"sv, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(3, "ухоженный пёс выразительные глаза"sv, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    server.AddDocument(4, "ухоженный скворец евгений"sv, DocumentStatus::BANNED, {9});
+
+    const std::vector<std::string> queries {"кот"s, "скворец"s, "пёс хвост"s, "ухоженный кот -белый"s};
+    const auto responses = ProcessQueries(server, queries);
+
+    const JoinedDocuments joined = ProcessQueriesFlat(server, queries);
+    ASSERT_EQUAL(joined.GetQueryCount(), queries.size());
+    ASSERT_EQUAL(joined.offsets.front(), 0ul);
+    ASSERT_EQUAL(joined.offsets.back(), joined.documents.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto page = joined.GetQueryDocuments(i);
+        ASSERT_EQUAL(page.size(), responses[i].size());
+        ASSERT(std::equal(page.begin, page.end, responses[i].begin(),
+                          [](const Document& lhs, const Document& rhs) {
+                              return lhs.id == rhs.id && lhs.relevance == rhs.relevance;
+                          }));
+    }
+    ASSERT_EQUAL(joined.GetQueryDocuments(1).size(), 0ul);
+
+    std::vector<int> expected_ids;
+    for (const auto& response : responses) {
+        for (const Document& document : response) {
+            expected_ids.push_back(document.id);
+        }
+    }
+    std::vector<int> joined_ids;
+    for (const Document& document : ProcessQueriesJoined(server, queries)) {
+        joined_ids.push_back(document.id);
+    }
+    ASSERT_EQUAL(joined_ids, expected_ids);
+    ASSERT_EQUAL(ProcessQueriesFlat(server, {}).GetQueryCount(), 0ul);
+    ASSERT_EQUAL(JoinedDocuments{}.GetQueryCount(), 0ul);
+}
+
+void TestThreadPool()
+{
+    ThreadPool pool(3);
+    ASSERT_EQUAL(pool.GetThreadCount(), 3ul);
+
+    std::vector<int> squares(1000);
+    pool.ParallelFor(squares.size(), [&squares](size_t i) {
+        squares[i] = static_cast<int>(i * i);
+    });
+    for (size_t i = 0; i < squares.size(); ++i) {
+        ASSERT_EQUAL(squares[i], static_cast<int>(i * i));
+    }
+
+    // Вложенные ParallelFor в большем числе задач, чем потоков, не блокируют пул
+    std::vector<std::future<int>> sums;
+    for (int task = 0; task < 20; ++task) {
+        sums.push_back(pool.Submit([&pool, task] {
+            std::atomic<int> sum{0};
+            pool.ParallelFor(100, [&sum, task](size_t i) { sum += task + static_cast<int>(i); });
+            return sum.load();
+        }));
+    }
+    for (int task = 0; task < 20; ++task) {
+        ASSERT_EQUAL(sums[static_cast<size_t>(task)].get(), task * 100 + 4950);
+    }
+
+    bool thrown = false;
+    try {
+        pool.ParallelFor(10, [](size_t i) {
+            if (i == 7) throw std::out_of_range("7");
+        });
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    SearchServer server("и в на"sv);
+    const std::vector<std::string> texts {"белый кот и модный ошейник"s, "пушистый кот пушистый хвост"s,
+                                          "ухоженный пёс выразительные глаза"s, "ухоженный скворец евгений"s};
+    std::vector<RawDocument> documents;
+    for (int id = 0; id < 200; ++id) {
+        documents.push_back({id, texts[static_cast<size_t>(id) % texts.size()],
+                             id % 3 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {id % 7}});
+    }
+    server.AddDocuments(ThreadPoolPolicy{pool}, documents);
+    server.RemoveDocuments(ThreadPoolPolicy{pool}, {4, 8, 15});
+    ASSERT_EQUAL(server.GetDocumentCount(), 197);
+
+    SearchServer duplicates_server("и в на"sv);
+    duplicates_server.AddDocuments(ThreadPoolPolicy{pool}, documents);
+    // Остаются только первые документы с каждым из четырёх текстов
+    ASSERT_EQUAL(RemoveDuplicates(ThreadPoolPolicy{pool}, duplicates_server).size(), 196ul);
+    ASSERT_EQUAL(duplicates_server.GetDocumentCount(), 4);
+    ASSERT(RemoveNearDuplicates(ThreadPoolPolicy{pool}, duplicates_server).empty());
+
+    const std::vector<std::string> queries {"кот"s, "ухоженный -пёс"s, "пушистый хвост"s, "скворец евгений"s};
+    std::vector<std::future<std::vector<Document>>> futures;
+    for (const std::string& query : queries) {
+        futures.push_back(server.FindTopDocumentsAsync(pool, query, DocumentStatus::BANNED));
+    }
+    const auto batch = ProcessQueries(pool, server, queries);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto expected = server.FindTopDocuments(queries[i]);
+        const auto found = server.FindTopDocuments(ThreadPoolPolicy{pool}, queries[i]);
+        ASSERT_EQUAL(found.size(), expected.size());
+        ASSERT_EQUAL(batch[i].size(), expected.size());
+        for (size_t j = 0; j < expected.size(); ++j) {
+            // У одинаковых текстов одинаковая релевантность, поэтому
+            // среди равных документов порядок id может быть любым
+            ASSERT(std::abs(found[j].relevance - expected[j].relevance) < EPSILON);
+            ASSERT_EQUAL(found[j].rating, expected[j].rating);
+            ASSERT(std::abs(batch[i][j].relevance - expected[j].relevance) < EPSILON);
+            ASSERT_EQUAL(batch[i][j].rating, expected[j].rating);
+        }
+
+        const auto expected_banned = server.FindTopDocuments(queries[i], DocumentStatus::BANNED);
+        const auto found_banned = futures[i].get();
+        ASSERT_EQUAL(found_banned.size(), expected_banned.size());
+        for (size_t j = 0; j < expected_banned.size(); ++j) {
+            ASSERT(std::abs(found_banned[j].relevance - expected_banned[j].relevance) < EPSILON);
+            ASSERT_EQUAL(found_banned[j].rating, expected_banned[j].rating);
+        }
+    }
+
+    thrown = false;
+    auto invalid = server.FindTopDocumentsAsync(pool, "кот --пёс"sv);
+    try {
+        invalid.get();
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestQueryBudget()
+{
+    const std::vector<std::string> words {"белый"s, "кот"s, "модный"s, "ошейник"s, "пушистый"s,
+                                          "хвост"s, "ухоженный"s, "пёс"s, "скворец"s, "евгений"s};
+    SearchServer server("и в на"sv);
+    for (int id = 0; id < 500; ++id) {
+        std::string text;
+        for (size_t i = 0; i < 3; ++i) {
+            text += words[static_cast<size_t>(id * 7 + static_cast<int>(i * i) * 3) % words.size()] + " "s;
+        }
+        server.AddDocument(id, text, id % 4 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL,
+                           {id % 9});
+    }
+
+    const auto check_complete = [&server](const TopDocuments& found, const std::string& query,
+                                          DocumentStatus status) {
+        ASSERT(!found.is_partial);
+        const auto expected = server.FindTopDocuments(query, status);
+        ASSERT_EQUAL(found.documents.size(), expected.size());
+        // Релевантность считается тем же кодом, поэтому совпадает точно
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(found.documents[i].id, expected[i].id);
+            ASSERT(found.documents[i].relevance == expected[i].relevance);
+            ASSERT_EQUAL(found.documents[i].rating, expected[i].rating);
+        }
+    };
+
+    const std::vector<std::string> queries {"кот пёс"s, "белый -хвост"s, "скворец евгений модный"s,
+                                            "неизвестное"s};
+    for (const std::string& query : queries) {
+        check_complete(FindTopDocumentsWithBudget(server, query, {}, DocumentStatus::ACTUAL, 5, 7),
+                       query, DocumentStatus::ACTUAL);
+    }
+
+    // Каждый вызов Resume обходит не больше заданного числа записей
+    QueryEvaluation evaluation(server, "кот пёс"sv);
+    size_t steps = 1;
+    while (!evaluation.Resume(1)) {
+        ++steps;
+    }
+    ASSERT(evaluation.IsFinished());
+    size_t posting_count = 0;
+    for (const int document_id : server) {
+        const auto& word_frequencies = server.GetWordFrequencies(document_id);
+        posting_count += word_frequencies.count("кот"sv) + word_frequencies.count("пёс"sv);
+    }
+    ASSERT_EQUAL(steps, posting_count);
+
+    QueryBudget cancelled;
+    cancelled.token.Cancel();
+    const TopDocuments partial = FindTopDocumentsWithBudget(server, "кот пёс"s, cancelled,
+                                                            DocumentStatus::ACTUAL, 5, 10);
+    ASSERT(partial.is_partial);
+    ASSERT(partial.documents.size() <= 5ul);
+
+    QueryBudget expired;
+    expired.deadline = std::chrono::steady_clock::now();
+    ASSERT(FindTopDocumentsWithBudget(server, "кот пёс"s, expired, DocumentStatus::ACTUAL, 5, 10).is_partial);
+
+    QueryScheduler scheduler(16);
+    std::vector<std::future<TopDocuments>> results;
+    for (const std::string& query : queries) {
+        results.push_back(scheduler.Submit(server, query, {}, DocumentStatus::BANNED));
+    }
+    auto cancelled_result = scheduler.Submit(server, "кот пёс белый"sv, cancelled);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        check_complete(results[i].get(), queries[i], DocumentStatus::BANNED);
+    }
+    ASSERT(cancelled_result.get().is_partial);
+
+    bool thrown = false;
+    try {
+        scheduler.Submit(server, "кот --пёс"sv);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    // Части нулевого размера не продвигают поиск и отвергаются
+    const auto throws_invalid_argument = [](const auto& action) {
+        try {
+            action();
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    ASSERT(throws_invalid_argument([&server] {
+        FindTopDocumentsWithBudget(server, "кот"s, {}, DocumentStatus::ACTUAL, 5, 0);
+    }));
+    ASSERT(throws_invalid_argument([&server] { QueryEvaluation(server, "кот"sv).Resume(0); }));
+    ASSERT(throws_invalid_argument([] { QueryScheduler zero_slice_scheduler(0); }));
+}
+
+void TestRelevanceAccumulator()
+{
+    using Hits = std::vector<std::pair<int, double>>;
+    RelevanceAccumulator accumulator(0, 100, true);
+    const auto collect = [&accumulator] {
+        Hits hits;
+        accumulator.ForEach([&hits](int document_id, double relevance) {
+            hits.emplace_back(document_id, relevance);
+        });
+        return hits;
+    };
+
+    accumulator.Add(5, 1.0);
+    accumulator.Add(3, 2.0);
+    accumulator.Add(5, 1.0);
+    ASSERT((collect() == Hits{{3, 2.0}, {5, 2.0}}));
+
+    // Ячейки прошлого запроса очищаются при сбросе на другой диапазон
+    accumulator.Reset(10, 50, true);
+    accumulator.Add(12, 1.0);
+    ASSERT((collect() == Hits{{12, 1.0}}));
+
+    accumulator.Reset(0, 4, true);
+    for (int id = 3; id >= 0; --id) {
+        accumulator.Add(id, 1.0);
+    }
+    ASSERT((collect() == Hits{{0, 1.0}, {1, 1.0}, {2, 1.0}, {3, 1.0}}));
+
+    accumulator.Reset(0, 0, false);
+    accumulator.Add(7, 1.0);
+    accumulator.Add(2, 0.5);
+    ASSERT((collect() == Hits{{2, 0.5}, {7, 1.0}}));
+}
+
 void TestStringViewConstructor()
 {
     const int doc_id = 42;
@@ -374,8 +1685,34 @@ void TestSearchServer()
     RUN_TEST(TestFilteredPredicate);
     RUN_TEST(TestSearchedStatus);
     RUN_TEST(TestCalcRelevance);
+    RUN_TEST(TestRelevanceAfterIndexUpdate);
     RUN_TEST(TestServerIterator);
     RUN_TEST(TestGetWordFrequencies);
     RUN_TEST(TestRemoveDocument);
+    RUN_TEST(TestRemovedDocumentNotFound);
+    RUN_TEST(TestParallelFindTopDocuments);
+    RUN_TEST(TestResultCount);
+    RUN_TEST(TestFindTopDocumentsWithPruning);
+    RUN_TEST(TestTextArena);
+    RUN_TEST(TestTextCompaction);
+    RUN_TEST(TestAddDocuments);
+    RUN_TEST(TestIndexSnapshot);
+    RUN_TEST(TestCompressedPostings);
+    RUN_TEST(TestCompressedIndex);
+    RUN_TEST(TestSplitIntoWords);
+    RUN_TEST(TestQueryContext);
+    RUN_TEST(TestStopWords);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestConcurrentSearchServer);
+    RUN_TEST(TestSegmentedSearchServer);
+    RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestNearDuplicates);
+    RUN_TEST(TestRemoveDocuments);
+    RUN_TEST(TestQueryCache);
+    RUN_TEST(TestFindTopDocumentsBatch);
+    RUN_TEST(TestProcessQueriesJoined);
+    RUN_TEST(TestThreadPool);
+    RUN_TEST(TestQueryBudget);
+    RUN_TEST(TestRelevanceAccumulator);
     RUN_TEST(TestStringViewConstructor);
 }
@@ -0,0 +1,36 @@
+#include "text_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+TextArena::TextArena(size_t chunk_size)
+    : chunk_size_{chunk_size}
+{
+}
+
+std::string_view TextArena::Store(const std::string_view text)
+{
+    if (text.empty()) return {};
+
+    if (chunks_.empty() || chunks_.back().capacity - chunks_.back().used < text.size()) {
+        const size_t capacity = std::max(chunk_size_, text.size());
+        chunks_.push_back({std::unique_ptr<char[]>(new char[capacity]), capacity, 0});
+    }
+
+    Chunk& chunk = chunks_.back();
+    char* const data = chunk.data.get() + chunk.used;
+    std::memcpy(data, text.data(), text.size());
+    chunk.used += text.size();
+    stored_size_ += text.size();
+    return {data, text.size()};
+}
+
+size_t TextArena::GetStoredSize() const
+{
+    return stored_size_;
+}
+
+size_t TextArena::GetChunkCount() const
+{
+    return chunks_.size();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Хранилище строк, выделяющее память крупными блоками. Сохранённые строки
+// никогда не перемещаются, поэтому string_view на них остаются корректными,
+// пока жив сам TextArena (в том числе после перемещения объекта).
+// Отдельные строки не освобождаются: чтобы вернуть память, нужно скопировать
+// живые строки в новый TextArena и заменить им старый.
+class TextArena {
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    explicit TextArena(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    TextArena(TextArena&&) = default;
+    TextArena& operator=(TextArena&&) = default;
+    TextArena(const TextArena&) = delete;
+    TextArena& operator=(const TextArena&) = delete;
+
+    std::string_view Store(const std::string_view text);
+
+    size_t GetStoredSize() const;
+    size_t GetChunkCount() const;
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t capacity;
+        size_t used;
+    };
+
+    size_t chunk_size_;
+    size_t stored_size_ = 0;
+    std::vector<Chunk> chunks_{};
+};
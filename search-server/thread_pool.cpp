@@ -0,0 +1,129 @@
+#include "thread_pool.h"
+
+#include <stdexcept>
+
+namespace {
+
+// Пул, которому принадлежит текущий поток, и номер потока в нём
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t thread_count)
+{
+    if (thread_count == 0) {
+        throw std::invalid_argument("В пуле должен быть хотя бы один поток");
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back(&ThreadPool::RunWorker, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard guard(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_up_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+    return threads_.size();
+}
+
+void ThreadPool::ParallelForState::Run()
+{
+    while (true) {
+        const size_t i = next.fetch_add(1);
+        if (i >= count) return;
+
+        std::exception_ptr iteration_error;
+        try {
+            function(i);
+        } catch (...) {
+            iteration_error = std::current_exception();
+        }
+
+        std::lock_guard guard(mutex);
+        if (iteration_error && !error) {
+            error = iteration_error;
+        }
+        if (++done == count) {
+            finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::Push(std::function<void()> task)
+{
+    const size_t queue = current_pool == this
+            ? current_worker
+            : next_queue_.fetch_add(1) % queues_.size();
+    // Счётчик растёт раньше, чем задача попадает в очередь, чтобы
+    // не уйти в минус, если её заберут сразу
+    ++pending_count_;
+    {
+        std::lock_guard guard(queues_[queue]->mutex);
+        queues_[queue]->tasks.push_back(std::move(task));
+    }
+
+    // Блокировка между увеличением счётчика и оповещением не даёт потоку
+    // уснуть, проверив счётчик до увеличения
+    {
+        std::lock_guard guard(sleep_mutex_);
+    }
+    wake_up_.notify_one();
+}
+
+bool ThreadPool::TryPop(size_t worker, std::function<void()>& task)
+{
+    {
+        WorkQueue& own = *queues_[worker];
+        std::lock_guard guard(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --pending_count_;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        WorkQueue& other = *queues_[(worker + i) % queues_.size()];
+        std::lock_guard guard(other.mutex);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            --pending_count_;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::RunWorker(size_t worker)
+{
+    current_pool = this;
+    current_worker = worker;
+
+    std::function<void()> task;
+    while (true) {
+        if (TryPop(worker, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock lock(sleep_mutex_);
+        wake_up_.wait(lock, [this] { return stopping_ || pending_count_ > 0; });
+        if (stopping_ && pending_count_ == 0) return;
+    }
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <execution>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Пул потоков с захватом работы: у каждого потока своя очередь задач.
+// Задачи, поставленные из потока пула, попадают в его очередь и берутся
+// с конца, а освободившийся поток забирает задачи из начала чужих очередей.
+// Число потоков задаётся явно, так что отдельный пул ограничивает
+// процессорное время, которое получает его владелец
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count = std::max(1u, std::thread::hardware_concurrency()));
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetThreadCount() const;
+
+    // Выполняет task() в потоке пула; исключение задачи передаётся через future
+    template <typename Task>
+    std::future<std::invoke_result_t<std::decay_t<Task>>> Submit(Task&& task);
+
+    // Вызывает function(i) для всех i из [0, count) и ждёт завершения.
+    // Вызывающий поток тоже выполняет итерации и не ждёт задач, которые
+    // ещё не начались, поэтому вложенный ParallelFor не блокирует пул.
+    // Первое исключение итерации выбрасывается после завершения остальных
+    template <typename Function>
+    void ParallelFor(size_t count, Function function);
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Общее состояние ParallelFor. Задачи-помощники держат его через
+    // shared_ptr: начавшийся поздно помощник не найдёт итераций и сразу выйдет
+    struct ParallelForState {
+        size_t count;
+        std::function<void(size_t)> function;
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t done = 0;
+        std::exception_ptr error;
+
+        // Выполняет свободные итерации, пока они есть
+        void Run();
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_queue_{0};
+
+    std::atomic<size_t> pending_count_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_up_;
+    bool stopping_ = false;
+
+    void Push(std::function<void()> task);
+    bool TryPop(size_t worker, std::function<void()>& task);
+    void RunWorker(size_t worker);
+};
+
+// Политика выполнения, направляющая параллельные части SearchServer в пул
+struct ThreadPoolPolicy {
+    ThreadPool& pool;
+};
+
+template <typename ExecutionPolicy>
+constexpr bool IsThreadPoolPolicy()
+{
+    return std::is_same_v<std::decay_t<ExecutionPolicy>, ThreadPoolPolicy>;
+}
+
+// std::for_each для стандартных политик и пула потоков
+template <typename ExecutionPolicy, typename RandomIt, typename Function>
+void ForEach(ExecutionPolicy&& policy, RandomIt first, RandomIt last, Function function)
+{
+    if constexpr (IsThreadPoolPolicy<ExecutionPolicy>()) {
+        policy.pool.ParallelFor(static_cast<size_t>(std::distance(first, last)),
+                                [first, &function](size_t i) {
+                                    function(first[static_cast<std::ptrdiff_t>(i)]);
+                                });
+    } else {
+        std::for_each(policy, first, last, function);
+    }
+}
+
+// std::sort для стандартных политик; в пуле сортировка последовательная
+template <typename ExecutionPolicy, typename RandomIt, typename Compare>
+void Sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last, Compare compare)
+{
+    if constexpr (IsThreadPoolPolicy<ExecutionPolicy>()) {
+        std::sort(first, last, compare);
+    } else {
+        std::sort(policy, first, last, compare);
+    }
+}
+
+template <typename Task>
+std::future<std::invoke_result_t<std::decay_t<Task>>> ThreadPool::Submit(Task&& task)
+{
+    using Result = std::invoke_result_t<std::decay_t<Task>>;
+    // std::function требует копируемой задачи, а packaged_task только перемещается
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+    std::future<Result> result = packaged->get_future();
+    Push([packaged] { (*packaged)(); });
+    return result;
+}
+
+template <typename Function>
+void ThreadPool::ParallelFor(size_t count, Function function)
+{
+    if (count == 0) return;
+    if (count == 1) {
+        function(0);
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->count = count;
+    state->function = std::ref(function);
+    const size_t helper_count = std::min(count - 1, threads_.size());
+    for (size_t i = 0; i < helper_count; ++i) {
+        Push([state] { state->Run(); });
+    }
+    state->Run();
+
+    std::unique_lock lock(state->mutex);
+    state->finished.wait(lock, [&state] { return state->done == state->count; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}